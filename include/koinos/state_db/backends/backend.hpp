@@ -1,10 +1,13 @@
 #pragma once
 
 #include <koinos/state_db/backends/iterator.hpp>
+#include <koinos/state_db/backends/value_handle.hpp>
 
 #include <koinos/crypto/multihash.hpp>
 #include <koinos/protocol/protocol.pb.h>
 
+#include <vector>
+
 namespace koinos::state_db::backends {
 
 class abstract_backend
@@ -21,13 +24,23 @@ public:
   virtual iterator end()   = 0;
 
   virtual void put( const key_type& k, const value_type& v ) = 0;
-  virtual const value_type* get( const key_type& ) const     = 0;
+  virtual value_handle get( const key_type& ) const          = 0;
   virtual void erase( const key_type& k )                    = 0;
   virtual void clear()                                       = 0;
 
+  virtual std::vector< value_handle > get_many( const std::vector< key_type >& ks ) const;
+
+  // Writes where the caller already knows whether the object existed, sparing the backend a lookup
+  virtual void put( const key_type& k, const value_type& v, bool exists );
+  virtual void erase( const key_type& k, bool exists );
+
   virtual size_type size() const = 0;
   bool empty() const;
 
+  /**
+   * Seek to a key. A backend may end a forward scan from the returned iterator after the last key
+   * of the object space the key belongs to, so callers only scan one object space at a time.
+   */
   virtual iterator find( const key_type& k )        = 0;
   virtual iterator lower_bound( const key_type& k ) = 0;
 
@@ -46,8 +59,17 @@ public:
   virtual void start_write_batch() = 0;
   virtual void end_write_batch()   = 0;
 
+  // Drops an unfinished write batch, leaving the stored state as it was before the batch started
+  virtual void abort_write_batch() = 0;
+
   virtual void store_metadata() = 0;
 
+  // Stores metadata for a state that the in memory fields do not describe yet
+  virtual void store_metadata( size_type revision,
+                               const crypto::multihash& id,
+                               const crypto::multihash& merkle_root,
+                               const protocol::block_header& header ) = 0;
+
   virtual std::shared_ptr< abstract_backend > clone() const = 0;
 
 private:
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <koinos/state_db/backends/types.hpp>
+#include <koinos/state_db/backends/value_handle.hpp>
 
 #include <memory>
 
@@ -20,6 +21,9 @@ public:
 
   virtual const key_type& key() const = 0;
 
+  /** Returns a handle that keeps the current value alive after the iterator moves. */
+  virtual value_handle handle() const;
+
   virtual abstract_iterator& operator++() = 0;
   virtual abstract_iterator& operator--() = 0;
 
@@ -44,18 +48,19 @@ public:
 
   const key_type& key() const;
   const value_type& value() const;
+  value_handle handle() const;
 
   iterator& operator++();
   iterator& operator--();
 
   iterator& operator=( iterator&& other );
 
+  bool valid() const;
+
   friend bool operator==( const iterator& x, const iterator& y );
   friend bool operator!=( const iterator& x, const iterator& y );
 
 private:
-  bool valid() const;
-
   std::unique_ptr< abstract_iterator > _itr;
 };
 
@@ -20,8 +20,11 @@ public:
   virtual iterator end() noexcept override;
 
   // Modifiers
+  using abstract_backend::erase;
+  using abstract_backend::put;
+
   virtual void put( const key_type& k, const value_type& v ) override;
-  virtual const value_type* get( const key_type& ) const override;
+  virtual value_handle get( const key_type& ) const override;
   virtual void erase( const key_type& k ) override;
   virtual void clear() noexcept override;
 
@@ -33,8 +36,13 @@ public:
 
   virtual void start_write_batch() override;
   virtual void end_write_batch() override;
+  virtual void abort_write_batch() override;
 
   virtual void store_metadata() override;
+  virtual void store_metadata( size_type revision,
+                               const crypto::multihash& id,
+                               const crypto::multihash& merkle_root,
+                               const protocol::block_header& header ) override;
 
   virtual std::shared_ptr< abstract_backend > clone() const override;
 
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <koinos/state_db/backends/types.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace koinos::state_db::backends::rocksdb {
+
+enum class cache_policy
+{
+  lru,
+  tinylfu
+};
+
+/**
+ * Decides whether an object leaving the object cache's admission window may displace the least
+ * recently used object of the main segment.
+ *
+ * A policy belongs to a single cache shard and is only called with that shard's mutex held.
+ */
+class admission_policy
+{
+public:
+  using key_type = detail::key_type;
+
+  virtual ~admission_policy() = default;
+
+  /** Notes an access of the key. Called for every cache lookup, hit or miss. */
+  virtual void record( const key_type& k ) = 0;
+
+  /** Returns true if the candidate should be kept in favor of the victim. */
+  virtual bool admit( const key_type& candidate, const key_type& victim ) = 0;
+};
+
+/**
+ * Admits every candidate, which makes the cache a plain LRU.
+ */
+class lru_policy final: public admission_policy
+{
+public:
+  virtual void record( const key_type& k ) override;
+  virtual bool admit( const key_type& candidate, const key_type& victim ) override;
+};
+
+/**
+ * TinyLFU admission. Access frequencies are estimated with a count-min sketch of saturating
+ * counters that is halved periodically, so old popularity fades. A candidate is only admitted
+ * if it has been accessed more often than the victim, which keeps one-off scans from flushing
+ * frequently read objects out of the cache.
+ */
+class tinylfu_policy final: public admission_policy
+{
+public:
+  tinylfu_policy( std::size_t expected_entries );
+
+  virtual void record( const key_type& k ) override;
+  virtual bool admit( const key_type& candidate, const key_type& victim ) override;
+
+  uint32_t estimate( const key_type& k ) const;
+
+private:
+  static constexpr std::size_t depth       = 4;
+  static constexpr uint8_t max_count       = 15;
+  static constexpr std::size_t sample_rate = 10;
+
+  std::size_t index( uint64_t hash, std::size_t row ) const;
+  void age();
+
+  std::vector< uint8_t > _counters;
+  std::size_t _width_mask = 0;
+  std::size_t _samples    = 0;
+  std::size_t _sample_size;
+};
+
+std::unique_ptr< admission_policy > make_admission_policy( cache_policy policy, std::size_t expected_entries );
+
+} // namespace koinos::state_db::backends::rocksdb
@@ -1,46 +1,104 @@
 #pragma once
 
+#include <koinos/state_db/backends/rocksdb/admission_policy.hpp>
 #include <koinos/state_db/backends/types.hpp>
 
 #include <rocksdb/slice.h>
 
+#include <atomic>
+#include <cstdint>
 #include <list>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace koinos::state_db::backends::rocksdb {
 
+/**
+ * A size bounded LRU cache of database objects.
+ *
+ * Keys are distributed over independently locked shards by hash, so concurrent readers only
+ * contend when they touch the same shard. Each shard indexes its LRU lists with a hash map and
+ * evicts from the tail once its share of the capacity is exceeded. A null value caches the
+ * absence of an object.
+ *
+ * New objects enter a small admission window. Objects pushed out of the window compete with the
+ * tail of the main segment, and the shard's admission_policy decides which one is kept. With
+ * cache_policy::lru the candidate always wins and the shard behaves as a single LRU list.
+ *
+ * Objects written in a batch are installed by end_writes once the batch is stored. Readers fill
+ * the cache with the version they saw before reading the database, and a fill is dropped when a
+ * batch was in flight or completed since, so a value read before the write cannot replace it.
+ */
 class object_cache
 {
 public:
   using key_type   = detail::key_type;
   using value_type = detail::value_type;
+  using write_set  = std::map< key_type, std::shared_ptr< const value_type > >;
+
+  static constexpr std::size_t default_size   = 64 << 20; // 64 MB
+  static constexpr std::size_t default_shards = 16;
+  static constexpr cache_policy default_policy = cache_policy::tinylfu;
 
 private:
-  using lru_list_type = std::list< key_type >;
-  using value_map_type =
-    std::map< key_type, std::pair< std::shared_ptr< const value_type >, typename lru_list_type::iterator > >;
+  struct entry
+  {
+    key_type key;
+    std::shared_ptr< const value_type > value;
+    bool in_window = true;
+  };
+
+  using lru_list_type  = std::list< entry >;
+  using value_map_type = std::unordered_map< std::string_view, typename lru_list_type::iterator >;
+
+  struct shard
+  {
+    lru_list_type window;
+    lru_list_type main;
+    value_map_type object_map;
+    std::size_t window_size = 0;
+    std::size_t main_size   = 0;
+    std::unique_ptr< admission_policy > policy;
+    std::mutex mutex;
+
+    void remove( typename value_map_type::iterator itr );
+    void evict( lru_list_type& list );
+  };
+
+  std::vector< shard > _shards;
+  const std::size_t _shard_max_size;
+  const std::size_t _window_max_size;
+  std::atomic< uint64_t > _version = 0; // Odd while a batch is being written
 
-  lru_list_type _lru_list;
-  value_map_type _object_map;
-  std::size_t _cache_size = 0;
-  const std::size_t _cache_max_size;
-  std::mutex _mutex;
+  void demote( shard& s );
+  void insert( shard& s, const key_type& k, std::shared_ptr< const value_type > v );
+
+  shard& get_shard( const key_type& k );
 
 public:
-  object_cache( std::size_t size );
+  object_cache( std::size_t size    = default_size,
+                std::size_t shards  = default_shards,
+                cache_policy policy = default_policy );
   ~object_cache();
 
   std::pair< bool, std::shared_ptr< const value_type > > get( const key_type& k );
   std::shared_ptr< const value_type > put( const key_type& k, std::shared_ptr< const value_type > v );
 
+  uint64_t version() const;
+  std::shared_ptr< const value_type >
+  fill( const key_type& k, std::shared_ptr< const value_type > v, uint64_t version );
+
+  void begin_writes();
+  void end_writes( const write_set& written );
+
   void remove( const key_type& k );
 
   void clear();
-
-  std::mutex& get_mutex();
 };
 
 } // namespace koinos::state_db::backends::rocksdb
@@ -4,10 +4,13 @@
 #include <koinos/state_db/backends/backend.hpp>
 #include <koinos/state_db/backends/rocksdb/object_cache.hpp>
 #include <koinos/state_db/backends/rocksdb/rocksdb_iterator.hpp>
+#include <koinos/state_db/state_db_options.hpp>
 
 #include <rocksdb/db.h>
 
+#include <atomic>
 #include <filesystem>
+#include <memory>
 #include <string>
 #include <utility>
 
@@ -20,15 +23,18 @@ public:
   using value_type = abstract_backend::value_type;
   using size_type  = abstract_backend::size_type;
 
-  rocksdb_backend();
+  rocksdb_backend( std::size_t cache_size   = object_cache::default_size,
+                   std::size_t cache_shards = object_cache::default_shards,
+                   cache_policy policy      = object_cache::default_policy );
   ~rocksdb_backend();
 
-  void open( const std::filesystem::path& p );
+  void open( const std::filesystem::path& p, const state_db_options& options = state_db_options() );
   void close();
   void flush();
 
   virtual void start_write_batch() override;
   virtual void end_write_batch() override;
+  virtual void abort_write_batch() override;
 
   // Iterators
   virtual iterator begin() override;
@@ -36,8 +42,11 @@ public:
 
   // Modifiers
   virtual void put( const key_type& k, const value_type& v ) override;
-  virtual const value_type* get( const key_type& ) const override;
+  virtual value_handle get( const key_type& ) const override;
+  virtual std::vector< value_handle > get_many( const std::vector< key_type >& ks ) const override;
   virtual void erase( const key_type& k ) override;
+  virtual void put( const key_type& k, const value_type& v, bool exists ) override;
+  virtual void erase( const key_type& k, bool exists ) override;
   virtual void clear() override;
 
   virtual size_type size() const override;
@@ -47,21 +56,38 @@ public:
   virtual iterator lower_bound( const key_type& k ) override;
 
   virtual void store_metadata() override;
+  virtual void store_metadata( size_type revision,
+                               const crypto::multihash& id,
+                               const crypto::multihash& merkle_root,
+                               const protocol::block_header& header ) override;
 
   virtual std::shared_ptr< abstract_backend > clone() const override;
 
 private:
   void load_metadata();
+  void load_legacy_metadata();
+  void ingest_batch();
+  void write( std::size_t column, const key_type& k, const value_type* v );
+  bool exists( const key_type& k ) const;
+  std::unique_ptr< rocksdb_iterator > seek( const key_type& k ) const;
 
   using column_handles = std::vector< std::shared_ptr< ::rocksdb::ColumnFamilyHandle > >;
 
   std::shared_ptr< ::rocksdb::DB > _db;
+  std::filesystem::path _path;
   std::optional< ::rocksdb::WriteBatch > _write_batch;
+  object_cache::write_set _batch_writes;
+  std::optional< std::string > _batch_metadata;
+  std::size_t _ingest_threshold = 0;
+  ::rocksdb::ColumnFamilyOptions _objects_options;
   column_handles _handles;
   ::rocksdb::WriteOptions _wopts;
   std::shared_ptr< ::rocksdb::ReadOptions > _ropts;
+  std::shared_ptr< ::rocksdb::ReadOptions > _scan_ropts;
+  std::shared_ptr< ::rocksdb::ReadOptions > _prefix_ropts;
   mutable std::shared_ptr< object_cache > _cache;
-  size_type _size = 0;
+  std::atomic< size_type > _size = 0;
+  size_type _batch_size           = 0;
 };
 
 } // namespace koinos::state_db::backends::rocksdb
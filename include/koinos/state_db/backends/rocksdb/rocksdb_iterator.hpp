@@ -5,6 +5,7 @@
 
 #include <rocksdb/db.h>
 
+#include <optional>
 #include <string>
 
 namespace koinos::state_db::backends::rocksdb {
@@ -27,6 +28,8 @@ public:
 
   virtual const key_type& key() const override;
 
+  virtual value_handle handle() const override;
+
   virtual abstract_iterator& operator++() override;
   virtual abstract_iterator& operator--() override;
 
@@ -37,6 +40,7 @@ private:
   virtual std::unique_ptr< abstract_iterator > copy() const override;
 
   void update_cache_value() const;
+  void release_prefix();
 
   std::shared_ptr< ::rocksdb::DB > _db;
   std::shared_ptr< ::rocksdb::ColumnFamilyHandle > _handle;
@@ -45,6 +49,12 @@ private:
   mutable std::shared_ptr< object_cache > _cache;
   mutable std::shared_ptr< const value_type > _cache_value;
   mutable std::shared_ptr< const key_type > _key;
+  uint64_t _cache_version = 0;
+
+  // Set while the iterator is bounded to the object space of the key it was seeked to, holding
+  // the first key after that space
+  std::shared_ptr< const ::rocksdb::ReadOptions > _prefix_opts;
+  std::optional< std::string > _prefix_end;
 };
 
 } // namespace koinos::state_db::backends::rocksdb
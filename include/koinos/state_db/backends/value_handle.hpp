@@ -0,0 +1,44 @@
+#pragma once
+
+#include <koinos/state_db/backends/types.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+namespace koinos::state_db::backends {
+
+/**
+ * A read only view of a stored value.
+ *
+ * Values read from RocksDB share ownership of the cached object, so the cache evicting it cannot
+ * free a value that is still referenced. Values held in memory by a map backend live as long as
+ * the backend and are borrowed. A null handle means the object does not exist.
+ */
+class value_handle final
+{
+public:
+  using value_type = detail::value_type;
+
+  value_handle() = default;
+  value_handle( std::nullptr_t );
+  value_handle( const value_type* value );
+  value_handle( std::shared_ptr< const value_type > value );
+
+  explicit operator bool() const;
+
+  std::string_view operator*() const;
+  const std::string_view* operator->() const;
+
+  std::string_view view() const;
+  std::size_t size() const;
+
+  friend bool operator==( const value_handle& h, std::nullptr_t );
+
+private:
+  std::shared_ptr< const value_type > _owner;
+  std::string_view _view;
+  bool _valid = false;
+};
+
+} // namespace koinos::state_db::backends
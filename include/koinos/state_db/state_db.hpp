@@ -1,5 +1,6 @@
 
 #pragma once
+#include <koinos/state_db/state_db_options.hpp>
 #include <koinos/state_db/state_db_types.hpp>
 
 #include <koinos/protocol/protocol.pb.h>
@@ -9,6 +10,7 @@
 #include <any>
 #include <cstddef>
 #include <filesystem>
+#include <future>
 #include <memory>
 #include <shared_mutex>
 #include <vector>
@@ -20,6 +22,8 @@ namespace detail {
 class database_impl;
 class state_node_impl;
 class anonymous_state_node_impl;
+class state_cursor_impl;
+struct lock_slot;
 
 } // namespace detail
 
@@ -36,6 +40,44 @@ enum class fork_resolution_algorithm
   pob
 };
 
+enum class scan_direction
+{
+  forward,
+  reverse
+};
+
+/**
+ * A cursor over a range of objects in an object space.
+ *
+ * The cursor holds its position in the merged state between steps rather than seeking
+ * for every object. Writing to the node being scanned invalidates the cursor.
+ */
+class state_cursor
+{
+public:
+  state_cursor( std::unique_ptr< detail::state_cursor_impl > impl );
+  state_cursor( state_cursor&& other );
+  ~state_cursor();
+
+  state_cursor& operator=( state_cursor&& other );
+
+  /**
+   * Return true if the cursor points to an object within the scanned range.
+   */
+  bool valid() const;
+
+  const object_key& key() const;
+  const object_value& value() const;
+
+  /**
+   * Move to the next object in the scan direction.
+   */
+  void next();
+
+private:
+  std::unique_ptr< detail::state_cursor_impl > _impl;
+};
+
 /**
  * Allows querying the database at a particular checkpoint.
  */
@@ -48,34 +90,49 @@ public:
   /**
    * Fetch an object if one exists.
    *
-   * - Size of the object is written into result.size
-   * - Object's value is copied into args.buf, provided buf != nullptr and buf_size is large enough
-   * - If buf is too small, buf is unchanged, however result is still updated
-   * - args.key is copied into result.key
+   * - Returns a handle viewing the object's value without copying it, a null handle if the object does not exist
+   * - A value read from the database is shared with the cache, the handle keeps it alive even if it is evicted
+   * - A value written by a pending state node is borrowed from that node and is valid while the node is alive
+   *   and the object is not written again
    */
-  const object_value* get_object( const object_space& space, const object_key& key ) const;
+  value_handle get_object( const object_space& space, const object_key& key ) const;
+
+  /**
+   * Fetch several objects at once.
+   *
+   * - Returns one value per requested key, in request order, a null handle if the object does not exist
+   * - Keys not modified by any pending state node are read from the database in a single batch
+   */
+  std::vector< value_handle > get_objects( const std::vector< object_space_key >& keys ) const;
 
   /**
    * Get the next object.
    *
-   * - Size of the object is written into result.size
-   * - Object's value is copied into args.buf, provided buf != nullptr and buf_size is large enough
-   * - If buf is too small, buf is unchanged, however result is still updated
-   * - Found key is written into result
+   * - Returns a handle to the found object's value and its key, a null handle if there is no next object
+   * - The handle is valid for as long as a handle returned by get_object would be
    */
-  std::pair< const object_value*, const object_key > get_next_object( const object_space& space,
-                                                                      const object_key& key ) const;
+  std::pair< value_handle, const object_key > get_next_object( const object_space& space,
+                                                               const object_key& key ) const;
 
   /**
    * Get the previous object.
    *
-   * - Size of the object is written into result.size
-   * - Object's value is copied into args.buf, provided buf != nullptr and buf_size is large enough
-   * - If buf is too small, buf is unchanged, however result is still updated
-   * - Found key is written into result
+   * - Returns a handle to the found object's value and its key, a null handle if there is no previous object
+   * - The handle is valid for as long as a handle returned by get_object would be
+   */
+  std::pair< value_handle, const object_key > get_prev_object( const object_space& space,
+                                                               const object_key& key ) const;
+
+  /**
+   * Scan the objects of an object space with keys in the range [start, end).
+   *
+   * - Objects are visited in key order, or in reverse key order when direction is reverse
+   * - An empty end key scans to the end of the object space
    */
-  std::pair< const object_value*, const object_key > get_prev_object( const object_space& space,
-                                                                      const object_key& key ) const;
+  state_cursor scan( const object_space& space,
+                     const object_key& start,
+                     const object_key& end    = object_key(),
+                     scan_direction direction = scan_direction::forward ) const;
 
   /**
    * Write an object into the state_node.
@@ -169,12 +226,54 @@ protected:
   std::shared_ptr< abstract_state_node > shared_from_derived() override;
 };
 
+/**
+ * A counted hold on the database lock, either shared or unique.
+ *
+ * Copies share the hold and the lock is released when the last copy is reset or destroyed. Holds
+ * are counted in slots the database allocates up front, each on its own cache line, so taking a
+ * lock does not allocate and copies of different holds do not contend on a counter.
+ */
+template< bool Unique >
+class lock_token final
+{
+public:
+  lock_token() = default;
+  lock_token( const lock_token& other );
+  lock_token( lock_token&& other ) noexcept;
+  ~lock_token();
+
+  lock_token& operator=( const lock_token& other );
+  lock_token& operator=( lock_token&& other ) noexcept;
+
+  void reset();
+
+  explicit operator bool() const;
+  const std::shared_mutex* mutex() const;
+
+  friend bool operator==( const lock_token& x, const lock_token& y )
+  {
+    return x._slot == y._slot;
+  }
+
+  friend bool operator!=( const lock_token& x, const lock_token& y )
+  {
+    return x._slot != y._slot;
+  }
+
+private:
+  friend class detail::database_impl;
+
+  explicit lock_token( detail::lock_slot* slot );
+
+  detail::lock_slot* _slot = nullptr;
+};
+
 using state_node_ptr                 = std::shared_ptr< state_node >;
 using genesis_init_function          = std::function< void( state_node_ptr ) >;
 using fork_list                      = std::vector< state_node_ptr >;
 using state_node_comparator_function = std::function< state_node_ptr( fork_list&, state_node_ptr, state_node_ptr ) >;
-using shared_lock_ptr                = std::shared_ptr< const std::shared_lock< std::shared_mutex > >;
-using unique_lock_ptr                = std::shared_ptr< const std::unique_lock< std::shared_mutex > >;
+using shared_lock_ptr                = lock_token< false >;
+using unique_lock_ptr                = lock_token< true >;
 
 state_node_ptr fifo_comparator( fork_list& forks, state_node_ptr current_head, state_node_ptr new_head );
 state_node_ptr block_time_comparator( fork_list& forks, state_node_ptr current_head, state_node_ptr new_head );
@@ -239,6 +338,24 @@ public:
              state_node_comparator_function comp,
              const unique_lock_ptr& lock );
 
+  /**
+   * Open the database, tuning RocksDB with the given options.
+   */
+  void open( const std::optional< std::filesystem::path >& p,
+             genesis_init_function init,
+             fork_resolution_algorithm algo,
+             const state_db_options& options,
+             const unique_lock_ptr& lock );
+
+  /**
+   * Open the database, tuning RocksDB with the given options.
+   */
+  void open( const std::optional< std::filesystem::path >& p,
+             genesis_init_function init,
+             state_node_comparator_function comp,
+             const state_db_options& options,
+             const unique_lock_ptr& lock );
+
   /**
    * Close the database.
    */
@@ -268,6 +385,27 @@ public:
   get_node_at_revision( uint64_t revision, const state_node_id& child_id, const unique_lock_ptr& lock ) const;
   state_node_ptr get_node_at_revision( uint64_t revision, const unique_lock_ptr& lock ) const;
 
+  /**
+   * Get the latest node that is an ancestor of both nodes. A node is its own ancestor.
+   *
+   * Return an empty pointer if either node does not exist.
+   */
+  state_node_ptr
+  get_common_ancestor( const state_node_id& a, const state_node_id& b, const shared_lock_ptr& lock ) const;
+
+  /**
+   * Get the latest node that is an ancestor of both nodes. A node is its own ancestor.
+   *
+   * Return an empty pointer if either node does not exist.
+   *
+   * WARNING: The state node returned does not have an internal lock. The caller
+   * must be careful to ensure internal consistency. Best practice is to not
+   * share this node with a parallel thread and to reset it before releasing the
+   * unique lock.
+   */
+  state_node_ptr
+  get_common_ancestor( const state_node_id& a, const state_node_id& b, const unique_lock_ptr& lock ) const;
+
   /**
    * Get the state_node for the given state_node_id.
    *
@@ -402,6 +540,18 @@ public:
    */
   void commit_node( const state_node_id& node_id, const unique_lock_ptr& lock );
 
+  /**
+   * Squash the node in to the root state without waiting for it to be written.
+   *
+   * The node becomes the root and the discarded nodes are pruned before returning. The state is
+   * written to the backend in the background, and until then reads of the node and its descendants
+   * go through the deltas beneath it. The node must be finalized.
+   *
+   * The returned future becomes ready once the state is stored, rethrowing if the write failed.
+   * The next call that commits, resets or closes the database waits for the write first.
+   */
+  std::shared_future< void > commit_node_async( const state_node_id& node_id, const unique_lock_ptr& lock );
+
   /**
    * Get and return the current "head" node.
    *
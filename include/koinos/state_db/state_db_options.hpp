@@ -0,0 +1,67 @@
+#pragma once
+
+#include <koinos/state_db/backends/rocksdb/admission_policy.hpp>
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace koinos::state_db {
+
+enum class compression_type
+{
+  none,
+  snappy,
+  lz4,
+  zstd
+};
+
+/**
+ * Tuning for the RocksDB database behind a persistent state_db.
+ *
+ * The RocksDB defaults match what state_db used before the options existed. The object cache now
+ * defaults to 16 shards under TinyLFU admission, where it used to be a single LRU cache. Set one
+ * shard and cache_policy::lru to restore the old cache. Options only take effect when the database
+ * is opened with a path, an in memory database ignores them.
+ */
+struct state_db_options
+{
+  // Object cache in front of RocksDB
+  std::size_t object_cache_size                       = 64 << 20; // 64 MB
+  std::size_t object_cache_shards                     = 16;
+  backends::rocksdb::cache_policy object_cache_policy = backends::rocksdb::cache_policy::tinylfu;
+
+  // Block based table. A block cache size of 0 keeps RocksDB's default block cache.
+  std::size_t block_cache_size       = 0;
+  std::size_t block_size             = 4 << 10; // 4 KB
+  double bloom_bits_per_key          = 0;       // 0 disables Bloom filters
+  bool partition_filters             = false;
+  bool whole_key_filtering           = true;
+  bool cache_index_and_filter_blocks = false;
+
+  // Extract the object space of each key as its prefix. Seeks stay within the space of their key,
+  // skipping files without it, and Bloom filters (see bloom_bits_per_key) are built on the space.
+  // Files are only skipped when Bloom filters are enabled. An existing database may be opened with
+  // or without the extractor, files written under the other setting are read without filtering.
+  bool object_space_prefix = false;
+
+  // Compression of each level, starting at level 0. Empty or unset leaves RocksDB's defaults.
+  std::vector< compression_type > compression_per_level;
+  std::optional< compression_type > bottommost_compression;
+
+  // Memtables
+  std::size_t write_buffer_size = 64 << 20; // 64 MB
+  int max_write_buffer_number   = 2;
+
+  // Write ahead log. Syncing makes every write durable on return, at the cost of an fsync.
+  bool sync_writes = false;
+
+  // Background work
+  int max_background_jobs = 2;
+  int max_open_files      = 64;
+
+  // Write batches holding at least this much data are ingested as SST files. 0 disables ingestion.
+  std::size_t ingest_threshold = 0;
+};
+
+} // namespace koinos::state_db
@@ -2,6 +2,9 @@
 
 #include <cstddef>
 #include <string>
+#include <utility>
+
+#include <koinos/state_db/backends/value_handle.hpp>
 
 #include <koinos/chain/chain.pb.h>
 #include <koinos/crypto/multihash.hpp>
@@ -13,6 +16,9 @@ using state_node_id = crypto::multihash;
 using object_space  = chain::object_space;
 using object_key    = std::string;
 using object_value  = std::string;
+using value_handle  = backends::value_handle;
+
+using object_space_key = std::pair< object_space, object_key >;
 
 KOINOS_DECLARE_DERIVED_EXCEPTION( state_db_exception, chain::reversion_exception );
 
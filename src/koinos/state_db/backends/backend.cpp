@@ -6,6 +6,27 @@ abstract_backend::abstract_backend():
     _id( crypto::multihash::zero( crypto::multicodec::sha2_256 ) )
 {}
 
+std::vector< value_handle > abstract_backend::get_many( const std::vector< key_type >& ks ) const
+{
+  std::vector< value_handle > values;
+  values.reserve( ks.size() );
+
+  for( const auto& k: ks )
+    values.push_back( get( k ) );
+
+  return values;
+}
+
+void abstract_backend::put( const key_type& k, const value_type& v, bool )
+{
+  put( k, v );
+}
+
+void abstract_backend::erase( const key_type& k, bool )
+{
+  erase( k );
+}
+
 bool abstract_backend::empty() const
 {
   return size() == 0;
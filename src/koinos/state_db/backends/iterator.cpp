@@ -3,6 +3,11 @@
 
 namespace koinos::state_db::backends {
 
+value_handle abstract_iterator::handle() const
+{
+  return value_handle( &**this );
+}
+
 iterator::iterator( std::unique_ptr< abstract_iterator > itr ):
     _itr( std::move( itr ) )
 {}
@@ -25,6 +30,11 @@ const iterator::key_type& iterator::key() const
   return _itr->key();
 }
 
+value_handle iterator::handle() const
+{
+  return _itr->handle();
+}
+
 iterator& iterator::operator++()
 {
   ++( *_itr );
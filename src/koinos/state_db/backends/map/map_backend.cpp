@@ -23,7 +23,7 @@ void map_backend::put( const key_type& k, const value_type& v )
   _map.insert_or_assign( k, v );
 }
 
-const map_backend::value_type* map_backend::get( const key_type& key ) const
+value_handle map_backend::get( const key_type& key ) const
 {
   auto itr = _map.find( key );
   if( itr == _map.end() )
@@ -66,8 +66,16 @@ void map_backend::start_write_batch() {}
 
 void map_backend::end_write_batch() {}
 
+void map_backend::abort_write_batch() {}
+
 void map_backend::store_metadata() {}
 
+void map_backend::store_metadata( size_type,
+                                  const crypto::multihash&,
+                                  const crypto::multihash&,
+                                  const protocol::block_header& )
+{}
+
 std::shared_ptr< abstract_backend > map_backend::clone() const
 {
   return std::make_shared< map_backend >( *this );
@@ -0,0 +1,100 @@
+#include <koinos/state_db/backends/rocksdb/admission_policy.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <string_view>
+
+namespace koinos::state_db::backends::rocksdb {
+
+namespace constants {
+constexpr std::size_t min_sketch_width = 1 << 6;
+constexpr std::size_t max_sketch_width = 1 << 20;
+} // namespace constants
+
+void lru_policy::record( const key_type& ) {}
+
+bool lru_policy::admit( const key_type&, const key_type& )
+{
+  return true;
+}
+
+tinylfu_policy::tinylfu_policy( std::size_t expected_entries )
+{
+  auto width = std::bit_ceil(
+    std::clamp( expected_entries, constants::min_sketch_width, constants::max_sketch_width ) );
+
+  _counters.resize( width * depth );
+  _width_mask  = width - 1;
+  _sample_size = width * sample_rate;
+}
+
+std::size_t tinylfu_policy::index( uint64_t hash, std::size_t row ) const
+{
+  // Each row uses a differently mixed copy of the key hash
+  hash += 0x9e3779b97f4a7c15ull * ( row + 1 );
+  hash  = ( hash ^ ( hash >> 30 ) ) * 0xbf58476d1ce4e5b9ull;
+  hash  = ( hash ^ ( hash >> 27 ) ) * 0x94d049bb133111ebull;
+  hash ^= hash >> 31;
+
+  return row * ( _width_mask + 1 ) + ( hash & _width_mask );
+}
+
+void tinylfu_policy::record( const key_type& k )
+{
+  const auto hash = std::hash< std::string_view >{}( k );
+
+  // Conservative update, only the smallest counters are incremented
+  const auto min = estimate( k );
+  if( min < max_count )
+  {
+    for( std::size_t row = 0; row < depth; ++row )
+    {
+      auto& counter = _counters[ index( hash, row ) ];
+      if( counter == min )
+        counter++;
+    }
+  }
+
+  if( ++_samples >= _sample_size )
+    age();
+}
+
+uint32_t tinylfu_policy::estimate( const key_type& k ) const
+{
+  const auto hash = std::hash< std::string_view >{}( k );
+  uint32_t min    = max_count;
+
+  for( std::size_t row = 0; row < depth; ++row )
+    min = std::min( min, uint32_t( _counters[ index( hash, row ) ] ) );
+
+  return min;
+}
+
+bool tinylfu_policy::admit( const key_type& candidate, const key_type& victim )
+{
+  return estimate( candidate ) > estimate( victim );
+}
+
+void tinylfu_policy::age()
+{
+  for( auto& counter: _counters )
+    counter >>= 1;
+
+  _samples /= 2;
+}
+
+std::unique_ptr< admission_policy > make_admission_policy( cache_policy policy, std::size_t expected_entries )
+{
+  switch( policy )
+  {
+    case cache_policy::lru:
+      return std::make_unique< lru_policy >();
+    case cache_policy::tinylfu:
+      return std::make_unique< tinylfu_policy >( expected_entries );
+  }
+
+  return std::make_unique< lru_policy >();
+}
+
+} // namespace koinos::state_db::backends::rocksdb
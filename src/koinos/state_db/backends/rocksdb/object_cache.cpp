@@ -1,76 +1,192 @@
 #include <koinos/state_db/backends/rocksdb/object_cache.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <functional>
 
 namespace koinos::state_db::backends::rocksdb {
 
-object_cache::object_cache( std::size_t size ):
-    _cache_max_size( size )
-{}
+namespace constants {
+// Share of each shard reserved for the admission window, in percent
+constexpr std::size_t window_percent = 1;
+// Assumed average object size, used to size the admission policy
+constexpr std::size_t average_entry_size = 256;
+} // namespace constants
+
+static std::size_t entry_size( const object_cache::key_type& k,
+                               const std::shared_ptr< const object_cache::value_type >& v )
+{
+  // Min 1 byte for key and 1 byte for value
+  return std::max( k.size() + ( v ? v->size() : 0 ), std::size_t( 2 ) );
+}
+
+object_cache::object_cache( std::size_t size, std::size_t shards, cache_policy policy ):
+    _shards( std::max( shards, std::size_t( 1 ) ) ),
+    _shard_max_size( size / _shards.size() ),
+    _window_max_size( _shard_max_size * constants::window_percent / 100 )
+{
+  for( auto& s: _shards )
+    s.policy = make_admission_policy( policy, _shard_max_size / constants::average_entry_size );
+}
 
 object_cache::~object_cache() {}
 
+object_cache::shard& object_cache::get_shard( const key_type& k )
+{
+  // The low bits pick the bucket inside the shard's map, so shards are picked with the high bits
+  const auto hash = std::hash< std::string_view >{}( k );
+  return _shards[ ( hash >> 32 ) % _shards.size() ];
+}
+
+void object_cache::shard::remove( typename value_map_type::iterator itr )
+{
+  auto list_itr = itr->second;
+  auto size     = entry_size( list_itr->key, list_itr->value );
+
+  object_map.erase( itr );
+
+  if( list_itr->in_window )
+  {
+    window_size -= size;
+    window.erase( list_itr );
+  }
+  else
+  {
+    main_size -= size;
+    main.erase( list_itr );
+  }
+
+  assert( object_map.size() == window.size() + main.size() );
+}
+
+void object_cache::shard::evict( lru_list_type& list )
+{
+  remove( object_map.find( list.back().key ) );
+}
+
+void object_cache::demote( shard& s )
+{
+  auto candidate = std::prev( s.window.end() );
+  auto size      = entry_size( candidate->key, candidate->value );
+
+  // The candidate replaces main segment objects only as long as the policy prefers it
+  while( !s.main.empty() && s.window_size + s.main_size > _shard_max_size )
+  {
+    if( !s.policy->admit( candidate->key, s.main.back().key ) )
+    {
+      s.evict( s.window );
+      return;
+    }
+
+    s.evict( s.main );
+  }
+
+  candidate->in_window = false;
+  s.window_size       -= size;
+  s.main_size         += size;
+  s.main.splice( s.main.begin(), s.window, candidate );
+}
+
 std::pair< bool, std::shared_ptr< const object_cache::value_type > > object_cache::get( const key_type& k )
 {
-  auto itr = _object_map.find( k );
-  if( itr == _object_map.end() )
-    return std::make_pair( false, std::shared_ptr< const object_cache::value_type >() );
+  auto& s = get_shard( k );
+  std::lock_guard lock( s.mutex );
 
-  // Erase the entry from the list and push front
-  _lru_list.erase( itr->second.second );
-  _lru_list.push_front( k );
-  auto val = itr->second.first;
+  s.policy->record( k );
 
-  _object_map[ k ] = std::make_pair( val, _lru_list.begin() );
+  auto itr = s.object_map.find( k );
+  if( itr == s.object_map.end() )
+    return std::make_pair( false, std::shared_ptr< const object_cache::value_type >() );
 
-  assert( _object_map.size() == _lru_list.size() );
+  // Move the entry to the front of its list, the map still points at the same node
+  auto& list = itr->second->in_window ? s.window : s.main;
+  list.splice( list.begin(), list, itr->second );
 
-  return std::make_pair( true, val );
+  return std::make_pair( true, itr->second->value );
 }
 
 std::shared_ptr< const object_cache::value_type >
 object_cache::put( const key_type& k, std::shared_ptr< const object_cache::value_type > v )
 {
-  remove( k );
+  auto& s = get_shard( k );
+  std::lock_guard lock( s.mutex );
 
-  // Min 1 byte for key and 1 byte for value
-  auto entry_size = std::max( k.size() + ( v ? v->size() : 0 ), std::size_t( 2 ) );
+  insert( s, k, v );
 
-  // If the cache is full, remove the last entry from the map and pop back
-  while( _cache_size + entry_size > _cache_max_size )
-    remove( _lru_list.back() );
+  return v;
+}
+
+void object_cache::insert( shard& s, const key_type& k, std::shared_ptr< const value_type > v )
+{
+  if( auto itr = s.object_map.find( k ); itr != s.object_map.end() )
+    s.remove( itr );
+
+  s.window.push_front( entry{ k, v } );
+  s.object_map.emplace( s.window.front().key, s.window.begin() );
+  s.window_size += entry_size( k, v );
+
+  // The new object always stays in the window so the returned value outlives this call
+  while( s.window.size() > 1 && s.window_size > _window_max_size )
+    demote( s );
+
+  // An object larger than the window takes the space it needs from the main segment
+  while( !s.main.empty() && s.window_size + s.main_size > _shard_max_size )
+    s.evict( s.main );
+
+  assert( s.object_map.size() == s.window.size() + s.main.size() );
+}
+
+uint64_t object_cache::version() const
+{
+  return _version;
+}
 
-  _lru_list.push_front( k );
-  _object_map[ k ]  = std::make_pair( v, _lru_list.begin() );
-  _cache_size      += entry_size;
+std::shared_ptr< const object_cache::value_type >
+object_cache::fill( const key_type& k, std::shared_ptr< const object_cache::value_type > v, uint64_t version )
+{
+  auto& s = get_shard( k );
+  std::lock_guard lock( s.mutex );
 
-  assert( _object_map.size() == _lru_list.size() );
+  // The value may predate a batch that is stored or being stored, it is returned without caching it
+  if( version == _version && !( version & 1 ) )
+    insert( s, k, v );
 
   return v;
 }
 
-void object_cache::remove( const key_type& k )
+void object_cache::begin_writes()
 {
-  auto itr = _object_map.find( k );
-  if( itr != _object_map.end() )
-  {
-    _cache_size -= std::max( k.size() + ( itr->second.first ? itr->second.first->size() : 0 ), std::size_t( 2 ) );
-    _lru_list.erase( itr->second.second );
-    _object_map.erase( itr );
-  }
+  _version++;
+}
 
-  assert( _object_map.size() == _lru_list.size() );
+void object_cache::end_writes( const write_set& written )
+{
+  for( const auto& [ k, v ]: written )
+    put( k, v );
+
+  _version++;
 }
 
-void object_cache::clear()
+void object_cache::remove( const key_type& k )
 {
-  _object_map.clear();
-  _lru_list.clear();
+  auto& s = get_shard( k );
+  std::lock_guard lock( s.mutex );
+
+  if( auto itr = s.object_map.find( k ); itr != s.object_map.end() )
+    s.remove( itr );
 }
 
-std::mutex& object_cache::get_mutex()
+void object_cache::clear()
 {
-  return _mutex;
+  for( auto& s: _shards )
+  {
+    std::lock_guard lock( s.mutex );
+    s.object_map.clear();
+    s.window.clear();
+    s.main.clear();
+    s.window_size = 0;
+    s.main_size   = 0;
+  }
 }
 
 } // namespace koinos::state_db::backends::rocksdb
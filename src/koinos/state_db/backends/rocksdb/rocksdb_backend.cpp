@@ -5,21 +5,37 @@
 #include <koinos/util/hex.hpp>
 #include <koinos/util/random.hpp>
 
+#include <rocksdb/cache.h>
 #include <rocksdb/convenience.h>
 #include <rocksdb/filter_policy.h>
+#include <rocksdb/slice_transform.h>
+#include <rocksdb/sst_file_writer.h>
+#include <rocksdb/table.h>
+
+#include <algorithm>
+#include <future>
+#include <thread>
 
 namespace koinos::state_db::backends::rocksdb {
 
 namespace constants {
-constexpr std::size_t cache_size     = 64 << 20; // 64 MB
-constexpr std::size_t max_open_files = 64;
-
 constexpr std::size_t default_column_index  = 0;
 const std::string objects_column_name       = "objects";
 constexpr std::size_t objects_column_index  = 1;
 const std::string metadata_column_name      = "metadata";
 constexpr std::size_t metadata_column_index = 2;
 
+const std::string metadata_key = "metadata";
+
+// Share of each memtable given to its Bloom filter when keys have an object space prefix
+constexpr double memtable_prefix_bloom_ratio = 0.1;
+
+// Ingested SST files are built here, inside the database directory
+const std::string ingest_directory = "ingest";
+// Ingested write batches are split into files of at least this much data
+constexpr std::size_t min_sst_file_size = 16 << 20; // 16 MB
+
+// Metadata keys used before the metadata was packed into a single record
 const std::string size_key         = "size";
 const std::string revision_key     = "revision";
 const std::string id_key           = "id";
@@ -33,6 +49,41 @@ const crypto::multihash merkle_root_default           = crypto::multihash::zero(
 const protocol::block_header block_header_default     = protocol::block_header();
 } // namespace constants
 
+static void append_field( std::string& record, const std::string& field )
+{
+  record.append( util::converter::as< std::string >( uint32_t( field.size() ) ) );
+  record.append( field );
+}
+
+static std::string read_field( std::string_view& record )
+{
+  KOINOS_ASSERT( record.size() >= sizeof( uint32_t ), rocksdb_read_exception, "malformed metadata record" );
+  auto size = util::converter::to< uint32_t >( std::string( record.substr( 0, sizeof( uint32_t ) ) ) );
+  record.remove_prefix( sizeof( uint32_t ) );
+
+  KOINOS_ASSERT( record.size() >= size, rocksdb_read_exception, "malformed metadata record" );
+  std::string field( record.substr( 0, size ) );
+  record.remove_prefix( size );
+
+  return field;
+}
+
+static std::string pack_metadata( rocksdb_backend::size_type size,
+                                  rocksdb_backend::size_type revision,
+                                  const crypto::multihash& id,
+                                  const crypto::multihash& merkle_root,
+                                  const protocol::block_header& header )
+{
+  std::string record;
+  append_field( record, util::converter::as< std::string >( size ) );
+  append_field( record, util::converter::as< std::string >( revision ) );
+  append_field( record, util::converter::as< std::string >( id ) );
+  append_field( record, util::converter::as< std::string >( merkle_root ) );
+  append_field( record, util::converter::as< std::string >( header ) );
+
+  return record;
+}
+
 bool setup_database( const std::filesystem::path& p )
 {
   std::vector< ::rocksdb::ColumnFamilyDescriptor > defs;
@@ -69,74 +120,159 @@ bool setup_database( const std::filesystem::path& p )
 
   status = db_ptr->Put( wopts,
                         &*handle_ptrs[ 1 ],
-                        ::rocksdb::Slice( constants::size_key ),
-                        ::rocksdb::Slice( util::converter::as< std::string >( constants::size_default ) ) );
+                        ::rocksdb::Slice( constants::metadata_key ),
+                        ::rocksdb::Slice( pack_metadata( constants::size_default,
+                                                         constants::revision_default,
+                                                         constants::id_default,
+                                                         constants::merkle_root_default,
+                                                         constants::block_header_default ) ) );
 
-  if( !status.ok() )
+  handle_ptrs.clear();
+  db_ptr.reset();
+
+  return status.ok();
+}
+
+static ::rocksdb::CompressionType to_rocksdb_compression( compression_type type )
+{
+  switch( type )
   {
-    handle_ptrs.clear();
-    db_ptr.reset();
-    return false;
+    case compression_type::snappy:
+      return ::rocksdb::kSnappyCompression;
+    case compression_type::lz4:
+      return ::rocksdb::kLZ4Compression;
+    case compression_type::zstd:
+      return ::rocksdb::kZSTD;
+    case compression_type::none:
+      [[fallthrough]];
+    default:
+      return ::rocksdb::kNoCompression;
   }
+}
 
-  status = db_ptr->Put( wopts,
-                        &*handle_ptrs[ 1 ],
-                        ::rocksdb::Slice( constants::revision_key ),
-                        ::rocksdb::Slice( util::converter::as< std::string >( constants::revision_default ) ) );
+/**
+ * Extracts the object space of an encoded key as its prefix.
+ *
+ * Keys start with the length delimited object space field of a chain::database_key, so keys that
+ * share the prefix share the space and sort next to each other.
+ */
+class object_space_prefix final: public ::rocksdb::SliceTransform
+{
+public:
+  virtual const char* Name() const override
+  {
+    return "koinos.ObjectSpacePrefix";
+  }
 
-  if( !status.ok() )
+  virtual ::rocksdb::Slice Transform( const ::rocksdb::Slice& key ) const override
   {
-    handle_ptrs.clear();
-    db_ptr.reset();
-    return false;
+    return ::rocksdb::Slice( key.data(), prefix_size( key ) );
   }
 
-  status = db_ptr->Put( wopts,
-                        &*handle_ptrs[ 1 ],
-                        ::rocksdb::Slice( constants::id_key ),
-                        ::rocksdb::Slice( util::converter::as< std::string >( constants::id_default ) ) );
+  virtual bool InDomain( const ::rocksdb::Slice& key ) const override
+  {
+    return prefix_size( key ) > 0;
+  }
 
-  if( !status.ok() )
+  // Returns the size of the object space field, or 0 if the key does not start with one
+  static std::size_t prefix_size( const ::rocksdb::Slice& key )
   {
-    handle_ptrs.clear();
-    db_ptr.reset();
-    return false;
+    constexpr char space_tag = 0x0a;
+
+    if( key.size() < 2 || key.data()[ 0 ] != space_tag )
+      return 0;
+
+    uint64_t len    = 0;
+    std::size_t pos = 1;
+
+    for( uint32_t shift = 0;; shift += 7 )
+    {
+      if( pos == key.size() || shift >= 64 )
+        return 0;
+
+      const auto byte = uint8_t( key.data()[ pos++ ] );
+      len |= uint64_t( byte & 0x7f ) << shift;
+
+      if( !( byte & 0x80 ) )
+        break;
+    }
+
+    return len <= key.size() - pos ? pos + len : 0;
   }
+};
 
-  status = db_ptr->Put( wopts,
-                        &*handle_ptrs[ 1 ],
-                        ::rocksdb::Slice( constants::merkle_root_key ),
-                        ::rocksdb::Slice( util::converter::as< std::string >( constants::merkle_root_default ) ) );
+// Returns the smallest key after every key that starts with the prefix, or empty if there is none
+static std::string prefix_successor( const ::rocksdb::Slice& prefix )
+{
+  auto successor = prefix.ToString();
 
-  if( !status.ok() )
+  while( !successor.empty() && uint8_t( successor.back() ) == 0xff )
+    successor.pop_back();
+
+  if( !successor.empty() )
+    successor.back()++;
+
+  return successor;
+}
+
+static ::rocksdb::ColumnFamilyOptions objects_column_options( const state_db_options& options )
+{
+  ::rocksdb::BlockBasedTableOptions table_options;
+  table_options.block_size                    = options.block_size;
+  table_options.whole_key_filtering           = options.whole_key_filtering;
+  table_options.cache_index_and_filter_blocks = options.cache_index_and_filter_blocks;
+
+  if( options.block_cache_size )
+    table_options.block_cache = ::rocksdb::NewLRUCache( options.block_cache_size );
+
+  if( options.bloom_bits_per_key > 0 )
+    table_options.filter_policy.reset( ::rocksdb::NewBloomFilterPolicy( options.bloom_bits_per_key ) );
+
+  // Partitioned filters are only supported with a partitioned index
+  if( options.partition_filters )
   {
-    handle_ptrs.clear();
-    db_ptr.reset();
-    return false;
+    table_options.partition_filters = true;
+    table_options.index_type        = ::rocksdb::BlockBasedTableOptions::kTwoLevelIndexSearch;
   }
 
-  status = db_ptr->Put( wopts,
-                        &*handle_ptrs[ 1 ],
-                        ::rocksdb::Slice( constants::block_header_key ),
-                        ::rocksdb::Slice( util::converter::as< std::string >( constants::block_header_default ) ) );
+  ::rocksdb::ColumnFamilyOptions column_options;
+  column_options.table_factory.reset( ::rocksdb::NewBlockBasedTableFactory( table_options ) );
+  column_options.write_buffer_size       = options.write_buffer_size;
+  column_options.max_write_buffer_number = options.max_write_buffer_number;
 
-  handle_ptrs.clear();
-  db_ptr.reset();
+  for( auto type: options.compression_per_level )
+    column_options.compression_per_level.push_back( to_rocksdb_compression( type ) );
 
-  return status.ok();
+  if( options.bottommost_compression )
+    column_options.bottommost_compression = to_rocksdb_compression( *options.bottommost_compression );
+
+  if( options.object_space_prefix )
+  {
+    column_options.prefix_extractor                 = std::make_shared< object_space_prefix >();
+    column_options.memtable_prefix_bloom_size_ratio = constants::memtable_prefix_bloom_ratio;
+    column_options.memtable_whole_key_filtering     = options.whole_key_filtering;
+  }
+
+  return column_options;
 }
 
-rocksdb_backend::rocksdb_backend():
-    _cache( std::make_shared< object_cache >( constants::cache_size ) ),
-    _ropts( std::make_shared< ::rocksdb::ReadOptions >() )
-{}
+rocksdb_backend::rocksdb_backend( std::size_t cache_size, std::size_t cache_shards, cache_policy policy ):
+    _cache( std::make_shared< object_cache >( cache_size, cache_shards, policy ) ),
+    _ropts( std::make_shared< ::rocksdb::ReadOptions >() ),
+    _scan_ropts( std::make_shared< ::rocksdb::ReadOptions >() ),
+    _prefix_ropts( std::make_shared< ::rocksdb::ReadOptions >() )
+{
+  // Scans from the first or last key cross object spaces, seeks within a space are bounded to it
+  _scan_ropts->total_order_seek       = true;
+  _prefix_ropts->prefix_same_as_start = true;
+}
 
 rocksdb_backend::~rocksdb_backend()
 {
   close();
 }
 
-void rocksdb_backend::open( const std::filesystem::path& p )
+void rocksdb_backend::open( const std::filesystem::path& p, const state_db_options& opts )
 {
   KOINOS_ASSERT( p.is_absolute(), rocksdb_open_exception, "path must be absolute, ${p}", ( "p", p.string() ) );
   KOINOS_ASSERT( std::filesystem::exists( p ),
@@ -144,15 +280,20 @@ void rocksdb_backend::open( const std::filesystem::path& p )
                  "path does not exist, ${p}",
                  ( "p", p.string() ) );
 
+  _objects_options  = objects_column_options( opts );
+  _ingest_threshold = opts.ingest_threshold;
+  _wopts.sync       = opts.sync_writes;
+
   std::vector< ::rocksdb::ColumnFamilyDescriptor > defs;
   defs.emplace_back( ::rocksdb::kDefaultColumnFamilyName, ::rocksdb::ColumnFamilyOptions() );
-  defs.emplace_back( constants::objects_column_name, ::rocksdb::ColumnFamilyOptions() );
+  defs.emplace_back( constants::objects_column_name, _objects_options );
   defs.emplace_back( constants::metadata_column_name, ::rocksdb::ColumnFamilyOptions() );
 
   std::vector< ::rocksdb::ColumnFamilyHandle* > handles;
 
   ::rocksdb::Options options;
-  options.max_open_files = constants::max_open_files;
+  options.max_open_files      = opts.max_open_files;
+  options.max_background_jobs = opts.max_background_jobs;
   ::rocksdb::DB* db;
 
   auto status = ::rocksdb::DB::Open( options, p.string(), defs, &handles, &db );
@@ -168,7 +309,8 @@ void rocksdb_backend::open( const std::filesystem::path& p )
                      + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
   }
 
-  _db = std::shared_ptr< ::rocksdb::DB >( db );
+  _db   = std::shared_ptr< ::rocksdb::DB >( db );
+  _path = p;
 
   for( auto* h: handles )
     _handles.emplace_back( h );
@@ -189,13 +331,17 @@ void rocksdb_backend::close()
 {
   if( _db )
   {
-    store_metadata();
+    // An unfinished write batch is abandoned, the stored metadata still matches the stored objects
+    if( _write_batch )
+      abort_write_batch();
+    else
+      store_metadata();
+
     flush();
 
     ::rocksdb::CancelAllBackgroundWork( &*_db, true );
     _handles.clear();
     _db.reset();
-    std::lock_guard lock( _cache->get_mutex() );
     _cache->clear();
   }
 }
@@ -214,28 +360,165 @@ void rocksdb_backend::start_write_batch()
 {
   KOINOS_ASSERT( !_write_batch, rocksdb_session_in_progress, "session already in progress" );
   _write_batch.emplace();
+  _batch_size = _size;
+  _cache->begin_writes();
 }
 
 void rocksdb_backend::end_write_batch()
 {
   if( _write_batch )
   {
-    auto status = _db->Write( _wopts, &*_write_batch );
+    try
+    {
+      // A large batch, such as a commit during initial sync, skips the memtable and WAL
+      if( _ingest_threshold && _write_batch->GetDataSize() >= _ingest_threshold )
+      {
+        ingest_batch();
+      }
+      else
+      {
+        auto status = _db->Write( _wopts, &*_write_batch );
+        KOINOS_ASSERT( status.ok(),
+                       rocksdb_write_exception,
+                       "unable to write session to rocksdb database"
+                         + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+      }
+    }
+    catch( ... )
+    {
+      abort_write_batch();
+      throw;
+    }
+
+    _size = _batch_size;
+    _write_batch.reset();
+    _batch_metadata.reset();
+
+    _cache->end_writes( _batch_writes );
+    _batch_writes.clear();
+  }
+}
+
+void rocksdb_backend::abort_write_batch()
+{
+  if( _write_batch )
+  {
+    // Nothing of the batch was stored, the cache keeps what it holds and accepts fills again
+    _write_batch.reset();
+    _batch_metadata.reset();
+    _batch_writes.clear();
+    _cache->end_writes( _batch_writes );
+  }
+}
+
+void rocksdb_backend::ingest_batch()
+{
+  /**
+   * The batch is ingested as sorted SST files. The writes are already ordered by key with one
+   * write per key, and are split in key ranges that are built into files in parallel. The metadata
+   * record is built into a file of its own, and all files are ingested at once, which is atomic
+   * across the column families.
+   */
+  auto dir = _path / constants::ingest_directory;
+  std::filesystem::remove_all( dir );
+  std::filesystem::create_directory( dir );
+
+  auto build_file = [ this ]( const std::string& path, auto&& write_entries )
+  {
+    const ::rocksdb::Options sst_options( ::rocksdb::DBOptions(), _objects_options );
+    ::rocksdb::SstFileWriter writer( ::rocksdb::EnvOptions(), sst_options );
+
+    auto status = writer.Open( path );
+    if( status.ok() )
+      status = write_entries( writer );
+    if( status.ok() )
+      status = writer.Finish();
+
     KOINOS_ASSERT( status.ok(),
                    rocksdb_write_exception,
-                   "unable to write session to rocksdb database"
+                   "unable to build sst file for rocksdb database"
                      + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
-    _write_batch.reset();
+
+    return path;
+  };
+
+  const std::size_t max_files = std::max( std::thread::hardware_concurrency(), 1u );
+  const std::size_t files     = std::min( { std::max( _write_batch->GetDataSize() / constants::min_sst_file_size,
+                                                      std::size_t( 1 ) ),
+                                            max_files,
+                                            _batch_writes.size() } );
+
+  std::vector< std::future< std::string > > builds;
+  builds.reserve( files );
+
+  auto first = _batch_writes.begin();
+  for( std::size_t f = 0; f < files; ++f )
+  {
+    auto last = std::next( first, _batch_writes.size() * ( f + 1 ) / files - _batch_writes.size() * f / files );
+
+    builds.push_back( std::async( std::launch::async,
+                                  build_file,
+                                  ( dir / ( "objects-" + std::to_string( f ) + ".sst" ) ).string(),
+                                  [ first, last ]( ::rocksdb::SstFileWriter& writer )
+                                  {
+                                    ::rocksdb::Status status;
+
+                                    for( auto itr = first; itr != last && status.ok(); ++itr )
+                                    {
+                                      const auto& [ k, v ] = *itr;
+                                      status = v ? writer.Put( ::rocksdb::Slice( k ), ::rocksdb::Slice( *v ) )
+                                                 : writer.Delete( ::rocksdb::Slice( k ) );
+                                    }
+
+                                    return status;
+                                  } ) );
+
+    first = last;
   }
+
+  std::vector< ::rocksdb::IngestExternalFileArg > args;
+
+  if( !builds.empty() )
+  {
+    auto& arg         = args.emplace_back();
+    arg.column_family = &*_handles[ constants::objects_column_index ];
+
+    for( auto& build: builds )
+      arg.external_files.push_back( build.get() );
+  }
+
+  if( _batch_metadata )
+  {
+    auto& arg         = args.emplace_back();
+    arg.column_family = &*_handles[ constants::metadata_column_index ];
+    arg.external_files.push_back( build_file( ( dir / "metadata.sst" ).string(),
+                                              [ & ]( ::rocksdb::SstFileWriter& writer )
+                                              {
+                                                return writer.Put( ::rocksdb::Slice( constants::metadata_key ),
+                                                                   ::rocksdb::Slice( *_batch_metadata ) );
+                                              } ) );
+  }
+
+  for( auto& arg: args )
+    arg.options.move_files = true;
+
+  auto status = _db->IngestExternalFiles( args );
+  std::filesystem::remove_all( dir );
+
+  KOINOS_ASSERT( status.ok(),
+                 rocksdb_write_exception,
+                 "unable to ingest session into rocksdb database"
+                   + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
 }
 
 iterator rocksdb_backend::begin()
 {
   KOINOS_ASSERT( _db, rocksdb_database_not_open_exception, "database not open" );
 
-  auto itr   = std::make_unique< rocksdb_iterator >( _db, _handles[ constants::objects_column_index ], _ropts, _cache );
+  auto itr =
+    std::make_unique< rocksdb_iterator >( _db, _handles[ constants::objects_column_index ], _scan_ropts, _cache );
   itr->_iter = std::unique_ptr< ::rocksdb::Iterator >(
-    _db->NewIterator( *_ropts, &*_handles[ constants::objects_column_index ] ) );
+    _db->NewIterator( *_scan_ropts, &*_handles[ constants::objects_column_index ] ) );
   itr->_iter->SeekToFirst();
 
   return iterator( std::unique_ptr< abstract_iterator >( std::move( itr ) ) );
@@ -245,9 +528,10 @@ iterator rocksdb_backend::end()
 {
   KOINOS_ASSERT( _db, rocksdb_database_not_open_exception, "database not open" );
 
-  auto itr   = std::make_unique< rocksdb_iterator >( _db, _handles[ constants::objects_column_index ], _ropts, _cache );
+  auto itr =
+    std::make_unique< rocksdb_iterator >( _db, _handles[ constants::objects_column_index ], _scan_ropts, _cache );
   itr->_iter = std::unique_ptr< ::rocksdb::Iterator >(
-    _db->NewIterator( *_ropts, &*_handles[ constants::objects_column_index ] ) );
+    _db->NewIterator( *_scan_ropts, &*_handles[ constants::objects_column_index ] ) );
 
   return iterator( std::unique_ptr< abstract_iterator >( std::move( itr ) ) );
 }
@@ -255,79 +539,144 @@ iterator rocksdb_backend::end()
 void rocksdb_backend::put( const key_type& k, const value_type& v )
 {
   KOINOS_ASSERT( _db, rocksdb_database_not_open_exception, "database not open" );
-  bool exists = get( k );
 
-  ::rocksdb::Status status;
+  put( k, v, exists( k ) );
+}
 
-  if( _write_batch )
-  {
-    status =
-      _write_batch->Put( &*_handles[ constants::objects_column_index ], ::rocksdb::Slice( k ), ::rocksdb::Slice( v ) );
-  }
-  else
+void rocksdb_backend::put( const key_type& k, const value_type& v, bool exists )
+{
+  KOINOS_ASSERT( _db, rocksdb_database_not_open_exception, "database not open" );
+
+  write( constants::objects_column_index, k, &v );
+
+  // The size of a batch is kept aside until the batch is written, readers see the stored size
+  if( !exists )
   {
-    status =
-      _db->Put( _wopts, &*_handles[ constants::objects_column_index ], ::rocksdb::Slice( k ), ::rocksdb::Slice( v ) );
+    if( _write_batch )
+      _batch_size++;
+    else
+      _size++;
   }
 
-  KOINOS_ASSERT( status.ok(),
-                 rocksdb_write_exception,
-                 "unable to write to rocksdb database"
-                   + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+  // Readers may still be reading the stored state, a batched write reaches the cache with the batch
+  if( _write_batch )
+    _batch_writes.insert_or_assign( k, std::make_shared< const object_cache::value_type >( v ) );
+  else
+    _cache->put( k, std::make_shared< const object_cache::value_type >( v ) );
+}
 
-  if( !exists )
+bool rocksdb_backend::exists( const key_type& k ) const
+{
+  // Inside a write batch an earlier write of the key decides, it is not stored yet
+  if( _write_batch )
   {
-    _size++;
+    if( auto itr = _batch_writes.find( k ); itr != _batch_writes.end() )
+      return (bool)itr->second;
   }
 
-  std::lock_guard lock( _cache->get_mutex() );
-  _cache->put( k, std::make_shared< const object_cache::value_type >( v ) );
+  return (bool)get( k );
 }
 
-const rocksdb_backend::value_type* rocksdb_backend::get( const key_type& k ) const
+value_handle rocksdb_backend::get( const key_type& k ) const
 {
   KOINOS_ASSERT( _db, rocksdb_database_not_open_exception, "database not open" );
 
-  std::lock_guard lock( _cache->get_mutex() );
   auto [ cache_hit, ptr ] = _cache->get( k );
   if( cache_hit )
-  {
-    if( ptr )
-      return &*ptr;
+    return ptr;
 
-    return nullptr;
-  }
+  auto version = _cache->version();
 
-  value_type value;
+  // Read into RocksDB's buffer so the value is only copied once, into the cached object
+  ::rocksdb::PinnableSlice value;
   auto status = _db->Get( *_ropts, &*_handles[ constants::objects_column_index ], ::rocksdb::Slice( k ), &value );
 
   if( status.ok() )
-    return &*_cache->put( k, std::make_shared< const object_cache::value_type >( value ) );
+    return _cache->fill( k, std::make_shared< const object_cache::value_type >( value.data(), value.size() ), version );
   else if( status.IsNotFound() )
-    _cache->put( k, std::shared_ptr< const object_cache::value_type >() );
+    _cache->fill( k, std::shared_ptr< const object_cache::value_type >(), version );
 
   return nullptr;
 }
 
+std::vector< value_handle > rocksdb_backend::get_many( const std::vector< key_type >& ks ) const
+{
+  KOINOS_ASSERT( _db, rocksdb_database_not_open_exception, "database not open" );
+
+  std::vector< value_handle > values( ks.size() );
+  std::vector< std::size_t > misses;
+
+  for( std::size_t i = 0; i < ks.size(); ++i )
+  {
+    auto [ cache_hit, ptr ] = _cache->get( ks[ i ] );
+    if( cache_hit )
+      values[ i ] = ptr;
+    else
+      misses.push_back( i );
+  }
+
+  if( misses.empty() )
+    return values;
+
+  auto version = _cache->version();
+
+  std::vector< ::rocksdb::Slice > slices;
+  slices.reserve( misses.size() );
+
+  for( auto i: misses )
+    slices.emplace_back( ks[ i ] );
+
+  std::vector< ::rocksdb::PinnableSlice > results( misses.size() );
+  std::vector< ::rocksdb::Status > statuses( misses.size() );
+
+  _db->MultiGet( *_ropts,
+                 &*_handles[ constants::objects_column_index ],
+                 misses.size(),
+                 slices.data(),
+                 results.data(),
+                 statuses.data() );
+
+  for( std::size_t j = 0; j < misses.size(); ++j )
+  {
+    const auto& k = ks[ misses[ j ] ];
+
+    if( statuses[ j ].ok() )
+      values[ misses[ j ] ] = _cache->fill(
+        k,
+        std::make_shared< const object_cache::value_type >( results[ j ].data(), results[ j ].size() ),
+        version );
+    else if( statuses[ j ].IsNotFound() )
+      _cache->fill( k, std::shared_ptr< const object_cache::value_type >(), version );
+  }
+
+  return values;
+}
+
 void rocksdb_backend::erase( const key_type& k )
 {
   KOINOS_ASSERT( _db, rocksdb_database_not_open_exception, "database not open" );
 
-  bool exists = get( k );
-  auto status = _db->Delete( _wopts, &*_handles[ constants::objects_column_index ], ::rocksdb::Slice( k ) );
+  erase( k, exists( k ) );
+}
 
-  KOINOS_ASSERT( status.ok(),
-                 rocksdb_write_exception,
-                 "unable to write to rocksdb database"
-                   + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+void rocksdb_backend::erase( const key_type& k, bool exists )
+{
+  KOINOS_ASSERT( _db, rocksdb_database_not_open_exception, "database not open" );
+
+  write( constants::objects_column_index, k, nullptr );
 
   if( exists )
   {
-    _size--;
+    if( _write_batch )
+      _batch_size--;
+    else
+      _size--;
   }
 
-  std::lock_guard lock( _cache->get_mutex() );
-  _cache->put( k, std::shared_ptr< const object_cache::value_type >() );
+  if( _write_batch )
+    _batch_writes.insert_or_assign( k, std::shared_ptr< const object_cache::value_type >() );
+  else
+    _cache->put( k, std::shared_ptr< const object_cache::value_type >() );
 }
 
 void rocksdb_backend::clear()
@@ -341,7 +690,6 @@ void rocksdb_backend::clear()
 
   _handles.clear();
   _db.reset();
-  std::lock_guard lock( _cache->get_mutex() );
   _cache->clear();
 }
 
@@ -356,22 +704,21 @@ iterator rocksdb_backend::find( const key_type& k )
 {
   KOINOS_ASSERT( _db, rocksdb_database_not_open_exception, "database not open" );
 
-  auto itr = std::make_unique< rocksdb_iterator >( _db, _handles[ constants::objects_column_index ], _ropts, _cache );
-  auto itr_ptr = std::unique_ptr< ::rocksdb::Iterator >(
-    _db->NewIterator( *_ropts, &*_handles[ constants::objects_column_index ] ) );
+  auto itr = seek( k );
 
-  itr_ptr->Seek( ::rocksdb::Slice( k ) );
-
-  if( itr_ptr->Valid() )
+  if( itr->_iter->Valid() )
   {
-    auto key_slice = itr_ptr->key();
+    auto key_slice = itr->_iter->key();
 
     if( k.size() == key_slice.size() && memcmp( k.data(), key_slice.data(), k.size() ) == 0 )
     {
-      itr->_iter = std::move( itr_ptr );
+      return iterator( std::unique_ptr< abstract_iterator >( std::move( itr ) ) );
     }
   }
 
+  itr->_iter.reset();
+  itr->_prefix_end.reset();
+
   return iterator( std::unique_ptr< abstract_iterator >( std::move( itr ) ) );
 }
 
@@ -379,19 +726,66 @@ iterator rocksdb_backend::lower_bound( const key_type& k )
 {
   KOINOS_ASSERT( _db, rocksdb_database_not_open_exception, "database not open" );
 
-  auto itr   = std::make_unique< rocksdb_iterator >( _db, _handles[ constants::objects_column_index ], _ropts, _cache );
-  itr->_iter = std::unique_ptr< ::rocksdb::Iterator >(
-    _db->NewIterator( *_ropts, &*_handles[ constants::objects_column_index ] ) );
+  return iterator( std::unique_ptr< abstract_iterator >( seek( k ) ) );
+}
+
+std::unique_ptr< rocksdb_iterator > rocksdb_backend::seek( const key_type& k ) const
+{
+  const auto& handle = _handles[ constants::objects_column_index ];
+  auto itr           = std::make_unique< rocksdb_iterator >( _db, handle, _scan_ropts, _cache );
+  const auto& prefix = _objects_options.prefix_extractor;
+
+  // A seek within an object space only reads files whose prefix Bloom filter holds the space
+  if( prefix && prefix->InDomain( ::rocksdb::Slice( k ) ) )
+  {
+    itr->_prefix_opts = _prefix_ropts;
+    itr->_prefix_end  = prefix_successor( prefix->Transform( ::rocksdb::Slice( k ) ) );
+    itr->_iter        = std::unique_ptr< ::rocksdb::Iterator >( _db->NewIterator( *_prefix_ropts, &*handle ) );
+  }
+  else
+  {
+    itr->_iter = std::unique_ptr< ::rocksdb::Iterator >( _db->NewIterator( *_scan_ropts, &*handle ) );
+  }
 
   itr->_iter->Seek( ::rocksdb::Slice( k ) );
 
-  return iterator( std::unique_ptr< abstract_iterator >( std::move( itr ) ) );
+  return itr;
 }
 
 void rocksdb_backend::load_metadata()
 {
   KOINOS_ASSERT( _db, rocksdb_database_not_open_exception, "database not open" );
 
+  std::string value;
+  auto status = _db->Get( *_ropts,
+                          &*_handles[ constants::metadata_column_index ],
+                          ::rocksdb::Slice( constants::metadata_key ),
+                          &value );
+
+  // Databases written before the metadata was packed keep each field under its own key
+  if( status.IsNotFound() )
+  {
+    load_legacy_metadata();
+    return;
+  }
+
+  KOINOS_ASSERT( status.ok(),
+                 rocksdb_read_exception,
+                 "unable to read from rocksdb database"
+                   + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+
+  std::string_view record( value );
+  _size = util::converter::to< size_type >( read_field( record ) );
+  set_revision( util::converter::to< size_type >( read_field( record ) ) );
+  set_id( util::converter::to< crypto::multihash >( read_field( record ) ) );
+  set_merkle_root( util::converter::to< crypto::multihash >( read_field( record ) ) );
+  set_block_header( util::converter::to< protocol::block_header >( read_field( record ) ) );
+}
+
+void rocksdb_backend::load_legacy_metadata()
+{
+  KOINOS_ASSERT( _db, rocksdb_database_not_open_exception, "database not open" );
+
   std::string value;
   auto status = _db->Get( *_ropts,
                           &*_handles[ constants::metadata_column_index ],
@@ -454,52 +848,41 @@ void rocksdb_backend::load_metadata()
 
 void rocksdb_backend::store_metadata()
 {
-  KOINOS_ASSERT( _db, rocksdb_database_not_open_exception, "database not open" );
-
-  auto status = _db->Put( _wopts,
-                          &*_handles[ constants::metadata_column_index ],
-                          ::rocksdb::Slice( constants::size_key ),
-                          ::rocksdb::Slice( util::converter::as< std::string >( _size ) ) );
-
-  KOINOS_ASSERT( status.ok(),
-                 rocksdb_write_exception,
-                 "unable to write to rocksdb database"
-                   + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
-
-  status = _db->Put( _wopts,
-                     &*_handles[ constants::metadata_column_index ],
-                     ::rocksdb::Slice( constants::revision_key ),
-                     ::rocksdb::Slice( util::converter::as< std::string >( revision() ) ) );
+  store_metadata( revision(), id(), merkle_root(), block_header() );
+}
 
-  KOINOS_ASSERT( status.ok(),
-                 rocksdb_write_exception,
-                 "unable to write to rocksdb database"
-                   + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+void rocksdb_backend::store_metadata( size_type revision,
+                                      const crypto::multihash& id,
+                                      const crypto::multihash& merkle_root,
+                                      const protocol::block_header& header )
+{
+  KOINOS_ASSERT( _db, rocksdb_database_not_open_exception, "database not open" );
 
-  status = _db->Put( _wopts,
-                     &*_handles[ constants::metadata_column_index ],
-                     ::rocksdb::Slice( constants::id_key ),
-                     ::rocksdb::Slice( util::converter::as< std::string >( id() ) ) );
+  auto record = pack_metadata( _write_batch ? _batch_size : _size.load(), revision, id, merkle_root, header );
 
-  KOINOS_ASSERT( status.ok(),
-                 rocksdb_write_exception,
-                 "unable to write to rocksdb database"
-                   + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+  // Inside a write batch the metadata is written atomically with the objects it describes
+  write( constants::metadata_column_index, constants::metadata_key, &record );
 
-  status = _db->Put( _wopts,
-                     &*_handles[ constants::metadata_column_index ],
-                     ::rocksdb::Slice( constants::merkle_root_key ),
-                     ::rocksdb::Slice( util::converter::as< std::string >( merkle_root() ) ) );
+  if( _write_batch )
+    _batch_metadata = record;
+}
 
-  KOINOS_ASSERT( status.ok(),
-                 rocksdb_write_exception,
-                 "unable to write to rocksdb database"
-                   + ( status.getState() ? ", " + std::string( status.getState() ) : "" ) );
+void rocksdb_backend::write( std::size_t column, const key_type& k, const value_type* v )
+{
+  /**
+   * Every mutation goes through here. While a write batch is open it is added to the batch, in
+   * order with the other writes of the commit, so a put followed by an erase of the same key
+   * (or the reverse) is applied as written and the commit is a single atomic Write.
+   */
+  auto handle = &*_handles[ column ];
+  ::rocksdb::Status status;
 
-  status = _db->Put( _wopts,
-                     &*_handles[ constants::metadata_column_index ],
-                     ::rocksdb::Slice( constants::block_header_key ),
-                     ::rocksdb::Slice( util::converter::as< std::string >( block_header() ) ) );
+  if( _write_batch )
+    status = v ? _write_batch->Put( handle, ::rocksdb::Slice( k ), ::rocksdb::Slice( *v ) )
+               : _write_batch->Delete( handle, ::rocksdb::Slice( k ) );
+  else
+    status = v ? _db->Put( _wopts, handle, ::rocksdb::Slice( k ), ::rocksdb::Slice( *v ) )
+               : _db->Delete( _wopts, handle, ::rocksdb::Slice( k ) );
 
   KOINOS_ASSERT( status.ok(),
                  rocksdb_write_exception,
@@ -11,7 +11,8 @@ rocksdb_iterator::rocksdb_iterator( std::shared_ptr< ::rocksdb::DB > db,
     _db( db ),
     _handle( handle ),
     _opts( opts ),
-    _cache( cache )
+    _cache( cache ),
+    _cache_version( _cache->version() )
 {}
 
 rocksdb_iterator::rocksdb_iterator( const rocksdb_iterator& other ):
@@ -19,11 +20,14 @@ rocksdb_iterator::rocksdb_iterator( const rocksdb_iterator& other ):
     _handle( other._handle ),
     _opts( other._opts ),
     _cache( other._cache ),
-    _cache_value( other._cache_value )
+    _cache_value( other._cache_value ),
+    _cache_version( other._cache_version ),
+    _prefix_opts( other._prefix_opts ),
+    _prefix_end( other._prefix_end )
 {
   if( other._iter )
   {
-    _iter.reset( _db->NewIterator( *_opts, &*_handle ) );
+    _iter.reset( _db->NewIterator( _prefix_end ? *_prefix_opts : *_opts, &*_handle ) );
 
     if( other._iter->Valid() )
     {
@@ -58,6 +62,18 @@ const rocksdb_iterator::key_type& rocksdb_iterator::key() const
   return *_key;
 }
 
+value_handle rocksdb_iterator::handle() const
+{
+  KOINOS_ASSERT( valid(), iterator_exception, "iterator operation is invalid" );
+
+  if( !_cache_value )
+  {
+    update_cache_value();
+  }
+
+  return value_handle( _cache_value );
+}
+
 abstract_iterator& rocksdb_iterator::operator++()
 {
   KOINOS_ASSERT( valid(), iterator_exception, "iterator operation is invalid" );
@@ -72,6 +88,12 @@ abstract_iterator& rocksdb_iterator::operator++()
 
 abstract_iterator& rocksdb_iterator::operator--()
 {
+  // Stepping back can leave the object space a bounded iterator is confined to
+  if( _prefix_end )
+  {
+    release_prefix();
+  }
+
   if( !valid() )
   {
     _iter.reset( _db->NewIterator( *_opts, &*_handle ) );
@@ -98,23 +120,41 @@ std::unique_ptr< abstract_iterator > rocksdb_iterator::copy() const
   return std::make_unique< rocksdb_iterator >( *this );
 }
 
+void rocksdb_iterator::release_prefix()
+{
+  auto iter = std::unique_ptr< ::rocksdb::Iterator >( _db->NewIterator( *_opts, &*_handle ) );
+
+  // A bounded iterator past the end of its object space stands on the first key after the space
+  if( valid() )
+  {
+    iter->Seek( _iter->key() );
+  }
+  else if( !_prefix_end->empty() )
+  {
+    iter->Seek( ::rocksdb::Slice( *_prefix_end ) );
+  }
+
+  _iter = std::move( iter );
+  _prefix_end.reset();
+}
+
 void rocksdb_iterator::update_cache_value() const
 {
   if( valid() )
   {
     auto key_slice = _iter->key();
     auto key       = std::make_shared< std::string >( key_slice.data(), key_slice.size() );
-    std::lock_guard< std::mutex > lock( _cache->get_mutex() );
-    auto [ cache_hit, ptr ] = _cache->get( *key );
-
-    if( cache_hit )
-      KOINOS_ASSERT( ptr, rocksdb_internal_exception, "iterator erroneously hit null value in cache" );
+    auto ptr       = _cache->get( *key ).second;
 
+    // The cache can hold the removal of an object this iterator's snapshot still sees, if the
+    // removal was written after the iterator was created. The snapshot's value is used then.
     if( !ptr )
     {
       auto value_slice = _iter->value();
-      ptr              = _cache->put( *key,
-                         std::make_shared< const object_cache::value_type >( value_slice.data(), value_slice.size() ) );
+      ptr              = _cache->fill(
+        *key,
+        std::make_shared< const object_cache::value_type >( value_slice.data(), value_slice.size() ),
+        _cache_version );
     }
 
     _cache_value = ptr;
@@ -0,0 +1,56 @@
+#include <koinos/state_db/backends/value_handle.hpp>
+
+namespace koinos::state_db::backends {
+
+value_handle::value_handle( std::nullptr_t ) {}
+
+value_handle::value_handle( const value_type* value )
+{
+  if( value )
+  {
+    _view  = *value;
+    _valid = true;
+  }
+}
+
+value_handle::value_handle( std::shared_ptr< const value_type > value ):
+    _owner( std::move( value ) )
+{
+  if( _owner )
+  {
+    _view  = *_owner;
+    _valid = true;
+  }
+}
+
+value_handle::operator bool() const
+{
+  return _valid;
+}
+
+std::string_view value_handle::operator*() const
+{
+  return _view;
+}
+
+const std::string_view* value_handle::operator->() const
+{
+  return &_view;
+}
+
+std::string_view value_handle::view() const
+{
+  return _view;
+}
+
+std::size_t value_handle::size() const
+{
+  return _view.size();
+}
+
+bool operator==( const value_handle& h, std::nullptr_t )
+{
+  return !h._valid;
+}
+
+} // namespace koinos::state_db::backends
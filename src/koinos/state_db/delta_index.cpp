@@ -0,0 +1,158 @@
+#include <koinos/state_db/delta_index.hpp>
+
+#include <atomic>
+#include <bit>
+#include <climits>
+#include <functional>
+
+namespace koinos::state_db::detail {
+
+namespace constants {
+constexpr uint32_t bits_per_level = 5;
+constexpr uint32_t level_mask     = ( 1u << bits_per_level ) - 1;
+constexpr uint32_t hash_bits      = sizeof( std::size_t ) * CHAR_BIT;
+} // namespace constants
+
+static uint64_t next_edit()
+{
+  static std::atomic< uint64_t > edit_counter = 1;
+  return edit_counter.fetch_add( 1, std::memory_order_relaxed );
+}
+
+delta_index::delta_index():
+    _root( std::make_shared< node >() )
+{}
+
+const delta_index::entry* delta_index::find( const key_type& k ) const
+{
+  const auto hash = std::hash< key_type >{}( k );
+  const node* n   = _root.get();
+
+  for( uint32_t shift = 0;; shift += constants::bits_per_level )
+  {
+    if( shift >= constants::hash_bits )
+    {
+      // Full hash collision, the remaining leaves are stored unordered
+      for( const auto& slot: n->slots )
+      {
+        const auto& l = std::get< leaf >( slot );
+        if( l.key == k )
+          return &l.value;
+      }
+
+      return nullptr;
+    }
+
+    const uint32_t bit = 1u << ( ( hash >> shift ) & constants::level_mask );
+    if( !( n->bitmap & bit ) )
+      return nullptr;
+
+    const auto& slot = n->slots[ std::popcount( n->bitmap & ( bit - 1 ) ) ];
+
+    if( const auto* l = std::get_if< leaf >( &slot ) )
+      return l->hash == hash && l->key == k ? &l->value : nullptr;
+
+    n = std::get< node_ptr >( slot ).get();
+  }
+}
+
+std::size_t delta_index::size() const
+{
+  return _size;
+}
+
+delta_index::node_ptr delta_index::editable( const node_ptr& n, uint64_t edit )
+{
+  if( n->edit == edit )
+    return n;
+
+  auto copy  = std::make_shared< node >( *n );
+  copy->edit = edit;
+  return copy;
+}
+
+delta_index::node_ptr delta_index::assoc( const node_ptr& n, uint32_t shift, leaf&& l, uint64_t edit, bool& added )
+{
+  auto target = editable( n, edit );
+
+  if( shift >= constants::hash_bits )
+  {
+    for( auto& slot: target->slots )
+    {
+      auto& existing = std::get< leaf >( slot );
+      if( existing.key == l.key )
+      {
+        existing.value = l.value;
+        return target;
+      }
+    }
+
+    target->slots.emplace_back( std::move( l ) );
+    added = true;
+    return target;
+  }
+
+  const uint32_t bit = 1u << ( ( l.hash >> shift ) & constants::level_mask );
+  const auto pos     = std::popcount( target->bitmap & ( bit - 1 ) );
+
+  if( !( target->bitmap & bit ) )
+  {
+    target->slots.emplace( target->slots.begin() + pos, std::move( l ) );
+    target->bitmap |= bit;
+    added           = true;
+    return target;
+  }
+
+  auto& slot = target->slots[ pos ];
+
+  if( auto* child = std::get_if< node_ptr >( &slot ) )
+  {
+    *child = assoc( *child, shift + constants::bits_per_level, std::move( l ), edit, added );
+  }
+  else if( auto& existing = std::get< leaf >( slot ); existing.key == l.key )
+  {
+    existing.value = l.value;
+  }
+  else
+  {
+    // Two different keys share this slot, push both down a level
+    auto sub  = std::make_shared< node >();
+    sub->edit = edit;
+
+    bool ignored = false;
+    sub          = assoc( sub, shift + constants::bits_per_level, std::move( existing ), edit, ignored );
+    sub          = assoc( sub, shift + constants::bits_per_level, std::move( l ), edit, added );
+    slot         = std::move( sub );
+  }
+
+  return target;
+}
+
+delta_index::builder::builder( const delta_index& base ):
+    _root( base._root ),
+    _size( base._size ),
+    _edit( next_edit() )
+{}
+
+void delta_index::builder::put( const key_type& k, const entry& e )
+{
+  bool added = false;
+  _root      = assoc( _root, 0, leaf{ std::hash< key_type >{}( k ), k, e }, _edit, added );
+
+  if( added )
+    _size++;
+}
+
+delta_index delta_index::builder::finish()
+{
+  delta_index index;
+  index._root = std::move( _root );
+  index._size = _size;
+
+  // Nodes owned by this builder become immutable once published
+  _edit = next_edit();
+
+  return index;
+}
+
+} // namespace koinos::state_db::detail
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <koinos/state_db/backends/types.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <variant>
+#include <vector>
+
+namespace koinos::state_db::detail {
+
+/**
+ * A persistent (immutable, structurally shared) hash array mapped trie from an object key
+ * to the newest modification of that key along a chain of state deltas.
+ *
+ * A child delta's index is created from its parent's index by inserting the child's own
+ * modifications. Only the path from the root of the trie to each modified key is copied,
+ * so the parent's index is left untouched and all unmodified subtrees are shared.
+ */
+class delta_index
+{
+public:
+  using key_type   = backends::detail::key_type;
+  using value_type = backends::detail::value_type;
+
+  struct entry
+  {
+    uint64_t revision       = 0;
+    const value_type* value = nullptr; // nullptr marks a removed object
+  };
+
+private:
+  struct node;
+  using node_ptr = std::shared_ptr< node >;
+
+  struct leaf
+  {
+    std::size_t hash;
+    key_type key;
+    entry value;
+  };
+
+  struct node
+  {
+    uint64_t edit   = 0;
+    uint32_t bitmap = 0;
+    std::vector< std::variant< node_ptr, leaf > > slots;
+  };
+
+  node_ptr _root;
+  std::size_t _size = 0;
+
+  static node_ptr editable( const node_ptr& n, uint64_t edit );
+  static node_ptr assoc( const node_ptr& n, uint32_t shift, leaf&& l, uint64_t edit, bool& added );
+
+public:
+  delta_index();
+
+  const entry* find( const key_type& k ) const;
+  std::size_t size() const;
+
+  /**
+   * Accumulates modifications on top of an existing index.
+   *
+   * Nodes created by a builder are mutated in place for the remainder of the build,
+   * so a batch of k insertions copies each shared node at most once.
+   */
+  class builder
+  {
+  public:
+    builder( const delta_index& base );
+
+    void put( const key_type& k, const entry& e );
+    delta_index finish();
+
+  private:
+    node_ptr _root;
+    std::size_t _size;
+    uint64_t _edit;
+  };
+};
+
+} // namespace koinos::state_db::detail
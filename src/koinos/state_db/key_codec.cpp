@@ -0,0 +1,189 @@
+#include <koinos/state_db/key_codec.hpp>
+
+#include <cstdint>
+
+namespace koinos::state_db::detail {
+
+namespace constants {
+// Protobuf wire tags of chain::database_key and chain::object_space
+constexpr char database_key_space_tag = 0x0a;
+constexpr char database_key_key_tag   = 0x12;
+constexpr char object_space_system    = 0x08;
+constexpr char object_space_zone      = 0x12;
+constexpr char object_space_id        = 0x18;
+} // namespace constants
+
+static void append_varint( std::string& out, uint64_t v )
+{
+  while( v >= 0x80 )
+  {
+    out.push_back( char( ( v & 0x7f ) | 0x80 ) );
+    v >>= 7;
+  }
+
+  out.push_back( char( v ) );
+}
+
+static bool read_varint( std::string_view& in, uint64_t& v )
+{
+  v = 0;
+
+  for( uint32_t shift = 0; shift < 64 && !in.empty(); shift += 7 )
+  {
+    const auto byte = uint8_t( in.front() );
+    in.remove_prefix( 1 );
+    v |= uint64_t( byte & 0x7f ) << shift;
+
+    if( !( byte & 0x80 ) )
+      return true;
+  }
+
+  return false;
+}
+
+static bool read_bytes( std::string_view& in, std::string_view& bytes )
+{
+  uint64_t len;
+  if( !read_varint( in, len ) || len > in.size() )
+    return false;
+
+  bytes = in.substr( 0, len );
+  in.remove_prefix( len );
+  return true;
+}
+
+static bool read_key( std::string_view in, object_key& key )
+{
+  if( in.empty() )
+  {
+    key.clear();
+    return true;
+  }
+
+  if( in.front() != constants::database_key_key_tag )
+    return false;
+
+  in.remove_prefix( 1 );
+
+  std::string_view bytes;
+  if( !read_bytes( in, bytes ) || !in.empty() )
+    return false;
+
+  key.assign( bytes.data(), bytes.size() );
+  return true;
+}
+
+key_codec::key_codec( const object_space& space )
+{
+  std::string space_bytes;
+
+  if( space.system() )
+  {
+    space_bytes.push_back( constants::object_space_system );
+    space_bytes.push_back( 0x01 );
+  }
+
+  if( !space.zone().empty() )
+  {
+    space_bytes.push_back( constants::object_space_zone );
+    append_varint( space_bytes, space.zone().size() );
+    space_bytes.append( space.zone() );
+  }
+
+  if( space.id() )
+  {
+    space_bytes.push_back( constants::object_space_id );
+    append_varint( space_bytes, space.id() );
+  }
+
+  _prefix.push_back( constants::database_key_space_tag );
+  append_varint( _prefix, space_bytes.size() );
+  _prefix.append( space_bytes );
+}
+
+std::string key_codec::encode( const object_key& key ) const
+{
+  std::string encoded;
+  encoded.reserve( _prefix.size() + key.size() + 6 );
+  encoded.append( _prefix );
+
+  if( !key.empty() )
+  {
+    encoded.push_back( constants::database_key_key_tag );
+    append_varint( encoded, key.size() );
+    encoded.append( key );
+  }
+
+  return encoded;
+}
+
+std::string key_codec::upper_bound() const
+{
+  // Every key in the space starts with the prefix, so the prefix's successor bounds them all
+  auto bound = _prefix;
+
+  while( !bound.empty() && uint8_t( bound.back() ) == 0xff )
+    bound.pop_back();
+
+  if( !bound.empty() )
+    bound.back()++;
+
+  return bound;
+}
+
+bool key_codec::decode( std::string_view encoded, object_key& key ) const
+{
+  // The space is length delimited, so sharing the prefix means sharing the space
+  if( encoded.substr( 0, _prefix.size() ) != _prefix )
+    return false;
+
+  return read_key( encoded.substr( _prefix.size() ), key );
+}
+
+bool key_codec::decode( std::string_view encoded, object_space& space, object_key& key )
+{
+  if( encoded.empty() || encoded.front() != constants::database_key_space_tag )
+    return false;
+
+  encoded.remove_prefix( 1 );
+
+  std::string_view space_bytes;
+  if( !read_bytes( encoded, space_bytes ) )
+    return false;
+
+  space = object_space();
+
+  while( !space_bytes.empty() )
+  {
+    const char tag = space_bytes.front();
+    space_bytes.remove_prefix( 1 );
+
+    uint64_t v;
+    std::string_view zone;
+
+    switch( tag )
+    {
+      case constants::object_space_system:
+        if( !read_varint( space_bytes, v ) )
+          return false;
+        space.set_system( v != 0 );
+        break;
+      case constants::object_space_zone:
+        if( !read_bytes( space_bytes, zone ) )
+          return false;
+        space.set_zone( std::string( zone ) );
+        break;
+      case constants::object_space_id:
+        if( !read_varint( space_bytes, v ) )
+          return false;
+        space.set_id( uint32_t( v ) );
+        break;
+      default:
+        return false;
+    }
+  }
+
+  return read_key( encoded, key );
+}
+
+} // namespace koinos::state_db::detail
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <koinos/state_db/state_db_types.hpp>
+
+#include <string>
+#include <string_view>
+
+namespace koinos::state_db::detail {
+
+/**
+ * Builds and parses the keys stored in state delta backends for a single object space.
+ *
+ * The encoding is byte for byte the wire format of a serialized chain::database_key. The
+ * merkle root, the iteration order and every existing database depend on it, so it cannot
+ * change. It is written directly rather than through a protobuf message, which makes
+ * building a key a copy of the precomputed space prefix followed by the object key.
+ */
+class key_codec
+{
+public:
+  explicit key_codec( const object_space& space );
+
+  std::string encode( const object_key& key ) const;
+
+  /**
+   * Returns the smallest encoded key that sorts after every key in this codec's object space.
+   */
+  std::string upper_bound() const;
+
+  /**
+   * Decode the object key of an encoded key.
+   *
+   * Returns false if the encoded key does not belong to this codec's object space.
+   */
+  bool decode( std::string_view encoded, object_key& key ) const;
+
+  /**
+   * Decode both the object space and object key of an encoded key.
+   *
+   * Returns false if the encoded key is malformed.
+   */
+  static bool decode( std::string_view encoded, object_space& space, object_key& key );
+
+private:
+  std::string _prefix;
+};
+
+} // namespace koinos::state_db::detail
@@ -1,272 +1,241 @@
 #include <koinos/state_db/merge_iterator.hpp>
 
+#include <algorithm>
+
 namespace koinos::state_db::detail {
 
-iterator_wrapper::iterator_wrapper( backends::iterator&& i,
-                                    uint64_t r,
-                                    std::shared_ptr< backends::abstract_backend > b ):
+merge_iterator::cursor::cursor( iterator_type&& i, std::shared_ptr< backends::abstract_backend > b ):
     itr( std::move( i ) ),
-    revision( r ),
     backend( b )
-{}
+{
+  update_key();
+}
 
-iterator_wrapper::iterator_wrapper( iterator_wrapper&& i ):
-    itr( std::move( i.itr ) ),
-    revision( i.revision ),
-    backend( i.backend )
-{}
+merge_iterator::cursor::cursor( const cursor& other ):
+    itr( other.itr ),
+    backend( other.backend ),
+    first_key( other.first_key ),
+    first_key_loaded( other.first_key_loaded )
+{
+  // A cursor that ran off the front of its backend may still hold a valid iterator on the first key
+  key = other.key ? &itr.key() : nullptr;
+}
+
+void merge_iterator::cursor::update_key()
+{
+  key = itr.valid() ? &itr.key() : nullptr;
+}
 
-iterator_wrapper::iterator_wrapper( const iterator_wrapper& i ):
-    itr( i.itr ),
-    revision( i.revision ),
-    backend( i.backend )
+merge_iterator::merge_iterator( const merge_iterator& other ):
+    _delta_deque( other._delta_deque ),
+    _cursors( other._cursors ),
+    _heap( other._heap ),
+    _forward( other._forward )
 {}
 
-const iterator_wrapper& iterator_wrapper::self() const
+merge_iterator& merge_iterator::operator=( const merge_iterator& other )
 {
+  if( this != &other )
+    *this = merge_iterator( other );
+
   return *this;
 }
 
-bool iterator_wrapper::valid() const
+bool merge_iterator::operator==( const merge_iterator& other ) const
 {
-  return itr != backend->end();
+  if( is_end() || other.is_end() )
+    return is_end() == other.is_end();
+
+  return key() == other.key();
 }
 
-bool iterator_compare_less::operator()( const iterator_wrapper& lhs, const iterator_wrapper& rhs ) const
+merge_iterator& merge_iterator::operator++()
 {
-  bool lh_valid = lhs.valid();
-  bool rh_valid = rhs.valid();
+  KOINOS_ASSERT( !is_end(), koinos::exception, "cannot increment an iterator past the end" );
+
+  if( !_forward )
+  {
+    // Rest every cursor on the first key at or after the current key
+    const key_type current = key();
+
+    for( auto& c: _cursors )
+    {
+      c.itr = c.backend->lower_bound( current );
+      c.update_key();
+    }
+
+    _forward = true;
+    build_heap();
+  }
 
-  if( !lh_valid && !rh_valid )
-    return lhs.revision > rhs.revision;
-  if( !lh_valid )
-    return false;
-  if( !rh_valid )
-    return true;
+  step();
+  resolve_conflicts();
 
-  return lhs.itr.key() < rhs.itr.key();
+  return *this;
 }
 
-bool iterator_compare_greater::operator()( const iterator_wrapper& lhs, const iterator_wrapper& rhs ) const
+merge_iterator& merge_iterator::operator--()
 {
-  bool lh_valid = lhs.valid();
-  bool rh_valid = rhs.valid();
+  if( _forward )
+  {
+    // Rest every cursor on the last key before the current key, the greatest of which is the new key
+    std::optional< key_type > current;
 
-  if( !lh_valid && !rh_valid )
-    return lhs.revision > rhs.revision;
-  if( !lh_valid )
-    return false;
-  if( !rh_valid )
-    return true;
+    if( !is_end() )
+      current = key();
 
-  return rhs.itr.key() < lhs.itr.key();
-}
+    for( auto& c: _cursors )
+    {
+      c.itr = current ? c.backend->lower_bound( *current ) : c.backend->end();
+      c.update_key();
+      retreat( c );
+    }
 
-merge_iterator::merge_iterator( const merge_iterator& other ):
-    _itr_revision_index( other._itr_revision_index ),
-    _delta_deque( other._delta_deque )
-{}
+    _forward = false;
+    build_heap();
+  }
+  else
+  {
+    KOINOS_ASSERT( !is_end(), koinos::exception, "cannot decrement an iterator past the beginning" );
+    step();
+  }
 
-bool merge_iterator::operator==( const merge_iterator& other ) const
+  resolve_conflicts();
+
+  return *this;
+}
+
+const merge_iterator::value_type& merge_iterator::operator*() const
 {
-  // If both iterators are empty, they are true.
-  // But we use empty merge iterators as an optimization for an end itertor.
-  // So if one is empty, and the other is all end iterators, they are also equal.
-  if( _itr_revision_index.size() == 0 && other._itr_revision_index.size() == 0 )
-    return true;
-  else if( _itr_revision_index.size() == 0 )
-    return other.is_end();
-  else if( other._itr_revision_index.size() == 0 )
-    return is_end();
-
-  auto my_begin    = _itr_revision_index.begin();
-  auto other_begin = other._itr_revision_index.begin();
-
-  if( !my_begin->valid() && !other_begin->valid() )
-    return true;
-  if( !my_begin->valid() || !other_begin->valid() )
-    return false;
-  if( my_begin->revision != other_begin->revision )
-    return false;
-
-  return my_begin->itr == other_begin->itr;
+  KOINOS_ASSERT( !is_end(), koinos::exception, "cannot dereference an invalid iterator" );
+
+  return *( _cursors[ _heap.front() ].itr );
 }
 
-merge_iterator& merge_iterator::operator++()
+const merge_iterator::key_type& merge_iterator::key() const
 {
-  auto first_itr = _itr_revision_index.begin();
-  KOINOS_ASSERT( first_itr->valid(), koinos::exception, "" );
-
-  _itr_revision_index.modify( first_itr,
-                              []( iterator_wrapper& i )
-                              {
-                                ++( i.itr );
-                              } );
-  resolve_conflicts();
+  KOINOS_ASSERT( !is_end(), koinos::exception, "cannot dereference an invalid iterator" );
 
-  return *this;
+  return *_cursors[ _heap.front() ].key;
 }
 
-merge_iterator& merge_iterator::operator--()
+backends::value_handle merge_iterator::handle() const
 {
-  const auto& order_idx = _itr_revision_index.template get< by_order_revision >();
+  KOINOS_ASSERT( !is_end(), koinos::exception, "cannot dereference an invalid iterator" );
 
-  auto head_itr = order_idx.begin();
-  std::optional< key_type > head_key;
+  return _cursors[ _heap.front() ].itr.handle();
+}
 
-  if( head_itr->valid() )
-    head_key = head_itr->itr.key();
+bool merge_iterator::heap_compare::operator()( std::size_t lhs, std::size_t rhs ) const
+{
+  return self->lower_priority( lhs, rhs );
+}
 
-  /* We are grabbing the current head value.
-   * Then iterate over all other iterators and rewind them until they have a value less
-   * than the current value. One of those values is what we want to decrement to.
-   */
-  const auto& rev_idx = _itr_revision_index.template get< by_revision >();
-  for( auto rev_itr = rev_idx.begin(); rev_itr != rev_idx.end(); ++rev_itr )
-  {
-    // Only decrement iterators that have modified objects
-    if( rev_itr->backend->size() )
-    {
-      auto begin = rev_itr->backend->begin();
-
-      if( !head_key )
-      {
-        // If there was no valid key, then bring back each iterator once, it is guaranteed to be less than the
-        // current value (end()).
-        _itr_revision_index.modify( _itr_revision_index.iterator_to( *rev_itr ),
-                                    [ & ]( iterator_wrapper& i )
-                                    {
-                                      --( i.itr );
-                                    } );
-      }
-      else
-      {
-        // Do an initial decrement if the iterator currently points to end()
-        if( !rev_itr->valid() )
-        {
-          _itr_revision_index.modify( _itr_revision_index.iterator_to( *rev_itr ),
-                                      [ & ]( iterator_wrapper& i )
-                                      {
-                                        --( i.itr );
-                                      } );
-        }
-
-        // Decrement back to the first key that is less than the head key
-        while( rev_itr->itr.key() >= *head_key && rev_itr->itr != begin )
-        {
-          _itr_revision_index.modify( _itr_revision_index.iterator_to( *rev_itr ),
-                                      [ & ]( iterator_wrapper& i )
-                                      {
-                                        --( i.itr );
-                                      } );
-        }
-      }
-
-      // The key at this point is guaranteed to be less than the head key (or at begin() and greator), but it
-      // might have been modified in a later index. We need to continue decrementing until we have a valid key.
-      bool dirty = true;
-
-      while( dirty && rev_itr->valid() && rev_itr->itr != begin )
-      {
-        dirty = is_dirty( rev_itr );
-
-        if( dirty )
-        {
-          _itr_revision_index.modify( _itr_revision_index.iterator_to( *( rev_itr ) ),
-                                      []( iterator_wrapper& i )
-                                      {
-                                        --( i.itr );
-                                      } );
-        }
-      }
-    }
-  }
+bool merge_iterator::lower_priority( std::size_t lhs, std::size_t rhs ) const
+{
+  const auto cmp = _cursors[ lhs ].key->compare( *_cursors[ rhs ].key );
 
-  const auto& rev_order_idx = _itr_revision_index.template get< by_reverse_order_revision >();
-  auto least_itr            = rev_order_idx.begin();
+  // Cursors are ordered root first, so the greater index is the newer delta and wins ties
+  if( cmp == 0 )
+    return lhs < rhs;
 
-  if( _delta_deque.size() > 1 )
-  {
-    // This next bit works in two modes.
-    // Some indices may not have had a value less than the previous head, so they will show up first,
-    // we need to increment through those values until we get the the new valid least value.
-    // We also could have dirty values show up first, so we need to get past those as well.
-    while( least_itr != rev_order_idx.end() && least_itr->valid()
-           && ( is_dirty( least_itr ) || ( head_key && least_itr->itr.key() >= *head_key ) ) )
-    {
-      ++least_itr;
-    }
+  return _forward ? cmp > 0 : cmp < 0;
+}
 
-    // Now least_itr points to the new least value, unless it is end()
-    if( least_itr != rev_order_idx.end() )
-    {
-      const auto& least_key = least_itr->itr.key();
-
-      // At this point every value is either end or less than or equal to the new value.
-      // We need to loop through each of the other iterators and increment them past this value.
-      auto& forward_idx = _itr_revision_index.template get< by_order_revision >();
-      auto forward_itr  = forward_idx.begin();
-
-      while( forward_itr != forward_idx.end() && forward_itr->itr.key() < least_key )
-      {
-        _itr_revision_index.modify( _itr_revision_index.iterator_to( *forward_itr ),
-                                    []( iterator_wrapper& i )
-                                    {
-                                      ++( i.itr );
-                                    } );
-        forward_itr = forward_idx.begin();
-      }
-    }
+void merge_iterator::build_heap()
+{
+  _heap.clear();
 
-    resolve_conflicts();
+  for( std::size_t i = 0; i < _cursors.size(); ++i )
+  {
+    if( _cursors[ i ].key )
+      _heap.push_back( i );
   }
 
-  return *this;
+  std::make_heap( _heap.begin(), _heap.end(), heap_compare{ this } );
 }
 
-const merge_iterator::value_type& merge_iterator::operator*() const
+void merge_iterator::push( std::size_t index )
 {
-  return _itr_revision_index.begin()->itr.operator*();
+  _heap.push_back( index );
+  std::push_heap( _heap.begin(), _heap.end(), heap_compare{ this } );
 }
 
-const merge_iterator::key_type& merge_iterator::key() const
+std::size_t merge_iterator::pop()
 {
-  auto first_itr = _itr_revision_index.begin();
-  KOINOS_ASSERT( first_itr->valid(), koinos::exception, "" );
+  std::pop_heap( _heap.begin(), _heap.end(), heap_compare{ this } );
+  auto index = _heap.back();
+  _heap.pop_back();
+  return index;
+}
+
+void merge_iterator::move( std::size_t index )
+{
+  auto& c = _cursors[ index ];
 
-  return first_itr->itr.key();
+  if( _forward )
+  {
+    ++( c.itr );
+    c.update_key();
+  }
+  else
+  {
+    retreat( c );
+  }
+
+  if( c.key )
+    push( index );
 }
 
-void merge_iterator::resolve_conflicts()
+void merge_iterator::step()
 {
-  auto first_itr = _itr_revision_index.begin();
-  bool dirty     = true;
+  // Every cursor on the current key moves past it. The top cursor moves last because its key
+  // is the one being compared against.
+  const auto top = pop();
+
+  while( !is_end() && *_cursors[ _heap.front() ].key == *_cursors[ top ].key )
+    move( pop() );
+
+  move( top );
+}
 
-  while( dirty && first_itr->valid() )
+void merge_iterator::retreat( cursor& c )
+{
+  if( !c.first_key_loaded )
   {
-    dirty = is_dirty( first_itr );
+    auto begin = c.backend->begin();
 
-    if( dirty )
-    {
-      _itr_revision_index.modify( first_itr,
-                                  []( iterator_wrapper& i )
-                                  {
-                                    ++( i.itr );
-                                  } );
-    }
+    if( begin.valid() )
+      c.first_key = begin.key();
 
-    first_itr = _itr_revision_index.begin();
+    c.first_key_loaded = true;
+  }
+
+  // There is nothing before the first key, or anywhere in an empty backend
+  if( !c.first_key || ( c.key && *c.key == *c.first_key ) )
+  {
+    c.key = nullptr;
+    return;
   }
+
+  --( c.itr );
+  c.update_key();
+}
+
+bool merge_iterator::is_dirty( std::size_t index ) const
+{
+  return _delta_deque.back()->is_modified_since( *_cursors[ index ].key, _delta_deque[ index ]->revision() );
+}
+
+void merge_iterator::resolve_conflicts()
+{
+  while( !is_end() && is_dirty( _heap.front() ) )
+    step();
 }
 
 bool merge_iterator::is_end() const
 {
-  return std::all_of( _itr_revision_index.begin(),
-                      _itr_revision_index.end(),
-                      []( auto& i )
-                      {
-                        return !i.valid();
-                      } );
+  return _heap.empty();
 }
 
 merge_state::merge_state( std::shared_ptr< state_delta > head ):
@@ -291,11 +260,16 @@ merge_iterator merge_state::end() const
                          } );
 }
 
-const merge_state::value_type* merge_state::find( const key_type& key ) const
+backends::value_handle merge_state::find( const key_type& key ) const
 {
   return _head->find( key );
 }
 
+std::vector< backends::value_handle > merge_state::find_many( const std::vector< key_type >& keys ) const
+{
+  return _head->find_many( keys );
+}
+
 merge_iterator merge_state::lower_bound( const key_type& key ) const
 {
   return merge_iterator( _head,
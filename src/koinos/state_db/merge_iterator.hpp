@@ -2,48 +2,26 @@
 
 #include <koinos/state_db/state_delta.hpp>
 
-#include <boost/iterator/zip_iterator.hpp>
-
-#include <boost/multi_index/composite_key.hpp>
-#include <boost/multi_index/mem_fun.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index_container.hpp>
+#include <boost/operators.hpp>
 
 #include <deque>
+#include <optional>
+#include <vector>
 
 namespace koinos::state_db::detail {
 
-using namespace boost::multi_index;
-
-struct iterator_wrapper
-{
-  iterator_wrapper( backends::iterator&& i, uint64_t r, std::shared_ptr< backends::abstract_backend > b );
-  iterator_wrapper( iterator_wrapper&& i );
-  iterator_wrapper( const iterator_wrapper& i );
-
-  const iterator_wrapper& self() const;
-  bool valid() const;
-
-  backends::iterator itr;
-  std::shared_ptr< backends::abstract_backend > backend;
-  uint64_t revision;
-};
-
-// Uses revision as a tiebreaker only for when both iterators are invalid
-// to enforce a total ordering on this comparator. The composite key on
-// revision is still needed for the case when iterators are valid and equal.
-// (i.e. lhs < rhs == false && rhs < lhs == false )
-struct iterator_compare_less
-{
-  bool operator()( const iterator_wrapper& lhs, const iterator_wrapper& rhs ) const;
-};
-
-struct iterator_compare_greater
-{
-  bool operator()( const iterator_wrapper& lhs, const iterator_wrapper& rhs ) const;
-};
-
+/**
+ * Iterates the merged view of a chain of state deltas.
+ *
+ * Each delta has a cursor into its backend. The cursors positioned on a key are kept in a
+ * binary heap ordered by key, with newer deltas winning ties, so stepping the merge costs
+ * O(log D) per delta that holds the current key. Keys shadowed by a newer delta are skipped
+ * as they reach the top of the heap.
+ *
+ * While moving forward every cursor rests on the first key at or after the current key. While
+ * moving backward every cursor rests on the last key at or before it. Changing direction seeks
+ * every cursor once around the current key.
+ */
 class merge_iterator: public boost::bidirectional_iterator_helper< merge_iterator,
                                                                    typename state_delta::value_type,
                                                                    std::size_t,
@@ -58,53 +36,60 @@ private:
   using iterator_type   = backends::iterator;
   using state_delta_ptr = std::shared_ptr< state_delta >;
 
-  struct by_order_revision;
-  struct by_reverse_order_revision;
-  struct by_revision;
-
-  using iter_revision_index_type = multi_index_container<
-    iterator_wrapper,
-    indexed_by<
-      ordered_unique<
-        tag< by_order_revision >,
-        composite_key< iterator_wrapper,
-                       const_mem_fun< iterator_wrapper, const iterator_wrapper&, &iterator_wrapper::self >,
-                       member< iterator_wrapper, uint64_t, &iterator_wrapper::revision > >,
-        composite_key_compare< iterator_compare_less, std::greater< uint64_t > > >,
-      ordered_unique<
-        tag< by_reverse_order_revision >,
-        composite_key< iterator_wrapper,
-                       const_mem_fun< iterator_wrapper, const iterator_wrapper&, &iterator_wrapper::self >,
-                       member< iterator_wrapper, uint64_t, &iterator_wrapper::revision > >,
-        composite_key_compare< iterator_compare_greater, std::greater< uint64_t > > >,
-      ordered_unique< tag< by_revision >, member< iterator_wrapper, uint64_t, &iterator_wrapper::revision > > > >;
-
-  iter_revision_index_type _itr_revision_index;
+  struct cursor
+  {
+    cursor( iterator_type&& i, std::shared_ptr< backends::abstract_backend > b );
+    cursor( const cursor& other );
+    cursor( cursor&& other ) = default;
+
+    void update_key();
+
+    iterator_type itr;
+    std::shared_ptr< backends::abstract_backend > backend;
+
+    // The key itr points to, nullptr when the cursor has run off either end of its backend
+    const key_type* key = nullptr;
+
+    // The first key of the backend, loaded the first time the cursor moves backward
+    std::optional< key_type > first_key;
+    bool first_key_loaded = false;
+  };
+
+  struct heap_compare
+  {
+    bool operator()( std::size_t lhs, std::size_t rhs ) const;
+
+    const merge_iterator* self;
+  };
+
   std::deque< state_delta_ptr > _delta_deque;
+  std::vector< cursor > _cursors;
+  std::vector< std::size_t > _heap;
+  bool _forward = true;
 
 public:
   template< typename Initializer >
   merge_iterator( state_delta_ptr head, Initializer&& init )
   {
     KOINOS_ASSERT( head, internal_error, "cannot create a merge iterator on a null delta" );
-    auto current_delta = head;
 
-    do
-    {
+    for( auto current_delta = head; current_delta; current_delta = current_delta->parent() )
       _delta_deque.push_front( current_delta );
 
-      _itr_revision_index.emplace( iterator_wrapper( std::move( init( current_delta->backend() ) ),
-                                                     current_delta->revision(),
-                                                     current_delta->backend() ) );
+    _cursors.reserve( _delta_deque.size() );
 
-      current_delta = current_delta->parent();
-    }
-    while( current_delta );
+    for( const auto& delta: _delta_deque )
+      _cursors.emplace_back( init( delta->backend() ), delta->backend() );
 
+    build_heap();
     resolve_conflicts();
   }
 
   merge_iterator( const merge_iterator& other );
+  merge_iterator( merge_iterator&& other ) = default;
+
+  merge_iterator& operator=( const merge_iterator& other );
+  merge_iterator& operator=( merge_iterator&& other ) = default;
 
   bool operator==( const merge_iterator& other ) const;
 
@@ -114,21 +99,17 @@ public:
   const value_type& operator*() const;
 
   const key_type& key() const;
+  backends::value_handle handle() const;
 
 private:
-  template< typename ItrType >
-  bool is_dirty( ItrType itr )
-  {
-    bool dirty = false;
-
-    for( auto i = _delta_deque.size() - 1; itr->revision < _delta_deque[ i ]->revision() && !dirty; --i )
-    {
-      dirty = _delta_deque[ i ]->is_modified( itr->itr.key() );
-    }
-
-    return dirty;
-  }
-
+  bool lower_priority( std::size_t lhs, std::size_t rhs ) const;
+  void build_heap();
+  void push( std::size_t index );
+  std::size_t pop();
+  void move( std::size_t index );
+  void step();
+  void retreat( cursor& c );
+  bool is_dirty( std::size_t index ) const;
   void resolve_conflicts();
   bool is_end() const;
 };
@@ -144,7 +125,8 @@ public:
   merge_iterator begin() const;
   merge_iterator end() const;
 
-  const value_type* find( const key_type& key ) const;
+  backends::value_handle find( const key_type& key ) const;
+  std::vector< backends::value_handle > find_many( const std::vector< key_type >& keys ) const;
   merge_iterator lower_bound( const key_type& key ) const;
 
 private:
@@ -1,17 +1,31 @@
 
 #include <koinos/chain/chain.pb.h>
 #include <koinos/exception.hpp>
+#include <koinos/state_db/key_codec.hpp>
 #include <koinos/state_db/merge_iterator.hpp>
 #include <koinos/state_db/state_db.hpp>
 #include <koinos/state_db/state_delta.hpp>
 #include <koinos/util/conversion.hpp>
 
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/identity.hpp>
+#include <boost/multi_index/mem_fun.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index_container.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
 #include <condition_variable>
 #include <cstring>
 #include <deque>
+#include <future>
 #include <mutex>
 #include <optional>
 #include <shared_mutex>
+#include <string_view>
+#include <thread>
 #include <unordered_set>
 #include <utility>
 
@@ -21,8 +35,10 @@ struct hash< koinos::crypto::multihash >
 {
   std::size_t operator()( const koinos::crypto::multihash& mh ) const
   {
-    static const std::hash< std::string > hash_fn;
-    return hash_fn( koinos::util::converter::as< std::string >( mh ) );
+    // Node ids are digests, whose bytes are already uniformly distributed
+    static const std::hash< std::string_view > hash_fn;
+    const auto& digest = mh.digest();
+    return hash_fn( std::string_view( reinterpret_cast< const char* >( digest.data() ), digest.size() ) );
   }
 };
 
@@ -62,27 +78,221 @@ namespace koinos::state_db {
 
 namespace detail {
 
+namespace constants {
+// Shared holds on the database lock are counted in at least this many slots, more on larger machines
+constexpr std::size_t min_shared_lock_slots = 64;
+} // namespace constants
+
 struct by_id;
 struct by_revision;
 struct by_parent;
+struct by_priority;
 
 using state_delta_ptr = std::shared_ptr< state_delta >;
 
 using state_multi_index_type = boost::multi_index_container<
   state_delta_ptr,
   boost::multi_index::indexed_by<
-    boost::multi_index::ordered_unique<
+    boost::multi_index::hashed_unique<
       boost::multi_index::tag< by_id >,
-      boost::multi_index::const_mem_fun< state_delta, const state_node_id&, &state_delta::id > >,
-    boost::multi_index::ordered_non_unique<
+      boost::multi_index::const_mem_fun< state_delta, const state_node_id&, &state_delta::id >,
+      std::hash< state_node_id > >,
+    boost::multi_index::hashed_non_unique<
       boost::multi_index::tag< by_parent >,
-      boost::multi_index::const_mem_fun< state_delta, const state_node_id&, &state_delta::parent_id > >,
+      boost::multi_index::const_mem_fun< state_delta, const state_node_id&, &state_delta::parent_id >,
+      std::hash< state_node_id > >,
     boost::multi_index::ordered_non_unique<
       boost::multi_index::tag< by_revision >,
       boost::multi_index::const_mem_fun< state_delta, uint64_t, &state_delta::revision > > > >;
 
+/**
+ * Orders fork heads by their priority under proof of burn: highest revision first, then the earliest
+ * block time, then the lowest id.
+ */
+struct fork_priority
+{
+  template< typename A, typename B >
+  bool operator()( const A& a, const B& b ) const
+  {
+    if( a->revision() > b->revision() )
+      return true;
+    else if( a->revision() < b->revision() )
+      return false;
+
+    if( a->block_header().timestamp() < b->block_header().timestamp() )
+      return true;
+    else if( a->block_header().timestamp() > b->block_header().timestamp() )
+      return false;
+
+    if( a->id() < b->id() )
+      return true;
+
+    return false;
+  }
+};
+
+using fork_heads_multi_index_type = boost::multi_index_container<
+  state_delta_ptr,
+  boost::multi_index::indexed_by<
+    boost::multi_index::ordered_unique<
+      boost::multi_index::tag< by_id >,
+      boost::multi_index::const_mem_fun< state_delta, const state_node_id&, &state_delta::id > >,
+    boost::multi_index::ordered_unique< boost::multi_index::tag< by_priority >,
+                                        boost::multi_index::identity< state_delta_ptr >,
+                                        fork_priority > > >;
+
+using comparator_pointer = state_node_ptr ( * )( fork_list&, state_node_ptr, state_node_ptr );
+
+/**
+ * The nodes of the index as readers see them, split in shards by id.
+ *
+ * Copying a snapshot_index shares its shards. The writer keeps its own snapshot_index next to the
+ * node index and copies a shard the first time it changes after being published, so publishing
+ * only copies the shard pointers and the shards changed since the previous publish.
+ */
+class snapshot_index
+{
+public:
+  state_delta_ptr find( const state_node_id& id ) const
+  {
+    const auto& shard = _shards[ shard_of( id ) ];
+
+    if( shard )
+    {
+      if( auto itr = shard->find( id ); itr != shard->end() )
+        return *itr;
+    }
+
+    return state_delta_ptr();
+  }
+
+  std::size_t size() const
+  {
+    return _size;
+  }
+
+  std::vector< state_delta_ptr > deltas() const
+  {
+    std::vector< state_delta_ptr > deltas;
+    deltas.reserve( _size );
+
+    for( const auto& shard: _shards )
+    {
+      if( shard )
+        deltas.insert( deltas.end(), shard->begin(), shard->end() );
+    }
+
+    return deltas;
+  }
+
+  void insert( const state_delta_ptr& delta )
+  {
+    if( editable_shard( delta->id() ).insert( delta ).second )
+      _size++;
+  }
+
+  void erase( const state_node_id& id )
+  {
+    _size -= editable_shard( id ).erase( id );
+  }
+
+  void clear()
+  {
+    _shards.fill( nullptr );
+    _owned.reset();
+    _size = 0;
+  }
+
+  // Returns a copy sharing every shard. The shards are copied before they are changed again.
+  snapshot_index publish()
+  {
+    _owned.reset();
+    return *this;
+  }
+
+private:
+  static constexpr std::size_t shard_count = 64;
+
+  using shard_type = boost::multi_index_container<
+    state_delta_ptr,
+    boost::multi_index::indexed_by<
+      boost::multi_index::hashed_unique<
+        boost::multi_index::tag< by_id >,
+        boost::multi_index::const_mem_fun< state_delta, const state_node_id&, &state_delta::id >,
+        std::hash< state_node_id > > > >;
+
+  static std::size_t shard_of( const state_node_id& id )
+  {
+    return std::hash< state_node_id >()( id ) % shard_count;
+  }
+
+  shard_type& editable_shard( const state_node_id& id )
+  {
+    const auto s = shard_of( id );
+
+    if( !_owned[ s ] )
+    {
+      _shards[ s ] = _shards[ s ] ? std::make_shared< shard_type >( *_shards[ s ] ) : std::make_shared< shard_type >();
+      _owned[ s ]  = true;
+    }
+
+    return *_shards[ s ];
+  }
+
+  std::array< std::shared_ptr< shard_type >, shard_count > _shards;
+  std::bitset< shard_count > _owned; // Shards not shared with a published snapshot
+  std::size_t _size = 0;
+};
+
+/**
+ * An immutable view of the node index, head, root and fork heads.
+ *
+ * Writers publish a new snapshot after every change to the index while holding the index mutex.
+ * Readers load the latest snapshot and never take the index mutex. A snapshot is freed when the
+ * last reader holding it lets it go.
+ *
+ * A reader sees the nodes, head, root and fork heads as of the last publish, for as long as it
+ * holds the snapshot. The deltas themselves are shared with the writer, so a delta of an older
+ * snapshot may have been finalized, committed or discarded since. Node handles made from it read
+ * the delta's current state.
+ */
+struct index_snapshot
+{
+  snapshot_index index;
+  state_delta_ptr head;
+  state_delta_ptr root;
+  std::vector< state_delta_ptr > fork_heads;
+};
+
+using index_snapshot_ptr = std::shared_ptr< const index_snapshot >;
+
+// The node index is hashed, so nodes are listed in id order by sorting them
+static std::vector< state_delta_ptr > sorted_by_id( const snapshot_index& index )
+{
+  auto deltas = index.deltas();
+  std::sort( deltas.begin(),
+             deltas.end(),
+             []( const state_delta_ptr& a, const state_delta_ptr& b )
+             {
+               return a->id() < b->id();
+             } );
+
+  return deltas;
+}
+
 const object_key null_key = object_key();
 
+/**
+ * Counts the holds on the database lock shared through one lock_token. A slot is free while its
+ * count is zero and the last hold to be released unlocks the mutex.
+ */
+struct alignas( 64 ) lock_slot
+{
+  std::atomic< uint32_t > refs = 0;
+  std::shared_mutex* mutex     = nullptr;
+  bool pooled                  = true;
+};
+
 /**
  * Private implementation of state_node interface.
  *
@@ -96,11 +306,12 @@ public:
 
   ~state_node_impl() {}
 
-  const object_value* get_object( const object_space& space, const object_key& key ) const;
-  std::pair< const object_value*, const object_key > get_next_object( const object_space& space,
-                                                                      const object_key& key ) const;
-  std::pair< const object_value*, const object_key > get_prev_object( const object_space& space,
-                                                                      const object_key& key ) const;
+  value_handle get_object( const object_space& space, const object_key& key ) const;
+  std::vector< value_handle > get_objects( const std::vector< object_space_key >& keys ) const;
+  std::pair< value_handle, const object_key > get_next_object( const object_space& space,
+                                                               const object_key& key ) const;
+  std::pair< value_handle, const object_key > get_prev_object( const object_space& space,
+                                                               const object_key& key ) const;
   int64_t put_object( const object_space& space, const object_key& key, const object_value* val );
   int64_t remove_object( const object_space& space, const object_key& key );
   crypto::multihash merkle_root() const;
@@ -110,6 +321,42 @@ public:
   shared_lock_ptr _lock;
 };
 
+/**
+ * Private implementation of state_cursor.
+ *
+ * Keeps a single merge iterator positioned within the scanned range. The bounds are kept
+ * encoded so each step compares raw keys and only decodes keys that are returned.
+ */
+class state_cursor_impl final
+{
+public:
+  state_cursor_impl( state_delta_ptr state,
+                     shared_lock_ptr lock,
+                     const object_space& space,
+                     const object_key& start,
+                     const object_key& end,
+                     scan_direction direction );
+
+  bool valid() const;
+  const object_key& key() const;
+  const object_value& value() const;
+  void next();
+
+private:
+  void check_bounds();
+
+  merge_state _state;
+  shared_lock_ptr _lock;
+  key_codec _codec;
+  std::string _start;
+  std::string _end;
+  scan_direction _direction;
+  std::optional< merge_iterator > _itr;
+  std::optional< merge_iterator > _limit;
+  object_key _key;
+  bool _valid = false;
+};
+
 /**
  * Private implementation of database interface.
  *
@@ -121,11 +368,16 @@ public:
 class database_impl final
 {
 public:
-  database_impl() {}
+  database_impl();
 
   ~database_impl()
   {
-    close_lockless();
+    try
+    {
+      close_lockless();
+    }
+    catch( ... )
+    {}
   }
 
   shared_lock_ptr get_shared_lock() const;
@@ -136,14 +388,17 @@ public:
   void open( const std::optional< std::filesystem::path >& p,
              genesis_init_function init,
              fork_resolution_algorithm algo,
+             const state_db_options& options,
              const unique_lock_ptr& lock );
   void open( const std::optional< std::filesystem::path >& p,
              genesis_init_function init,
              state_node_comparator_function comp,
+             const state_db_options& options,
              const unique_lock_ptr& lock );
   void open_lockless( const std::optional< std::filesystem::path >& p,
                       genesis_init_function init,
-                      state_node_comparator_function comp );
+                      state_node_comparator_function comp,
+                      const state_db_options& options );
   void close( const unique_lock_ptr& lock );
   void close_lockless();
 
@@ -152,6 +407,10 @@ public:
   get_node_at_revision( uint64_t revision, const state_node_id& child, const shared_lock_ptr& lock ) const;
   state_node_ptr
   get_node_at_revision( uint64_t revision, const state_node_id& child, const unique_lock_ptr& lock ) const;
+  state_node_ptr
+  get_common_ancestor( const state_node_id& a, const state_node_id& b, const shared_lock_ptr& lock ) const;
+  state_node_ptr
+  get_common_ancestor( const state_node_id& a, const state_node_id& b, const unique_lock_ptr& lock ) const;
   state_node_ptr get_node( const state_node_id& node_id, const shared_lock_ptr& lock ) const;
   state_node_ptr get_node( const state_node_id& node_id, const unique_lock_ptr& lock ) const;
   state_node_ptr get_node_lockless( const state_node_id& node_id ) const;
@@ -181,6 +440,11 @@ public:
                      const unique_lock_ptr& lock );
   void discard_node_lockless( const state_node_id& node, const std::unordered_set< state_node_id >& whitelist );
   void commit_node( const state_node_id& node, const unique_lock_ptr& lock );
+  std::shared_future< void > commit_node_async( const state_node_id& node, const unique_lock_ptr& lock );
+  void finish_commit_lockless();
+  void write_root_lockless();
+  void commit_node_lockless( const state_node_id& node_id );
+  void commit_delta_lockless( const state_node_id& node_id );
 
   state_node_ptr get_head( const shared_lock_ptr& lock ) const;
   state_node_ptr get_head( const unique_lock_ptr& lock ) const;
@@ -191,23 +455,50 @@ public:
   std::vector< state_node_ptr > get_all_nodes( const unique_lock_ptr& lock ) const;
   state_node_ptr get_root( const shared_lock_ptr& lock ) const;
   state_node_ptr get_root( const unique_lock_ptr& lock ) const;
-  state_node_ptr get_root_lockless() const;
+
+  static state_node_ptr node_handle( const state_delta_ptr& delta, const shared_lock_ptr& lock = shared_lock_ptr() );
+
+  state_node_ptr resolve_fork_lockless( const state_node_ptr& head, const state_node_ptr& node ) const;
+
+  bool insert_node_lockless( const state_delta_ptr& delta );
+  void publish_snapshot_lockless();
+  index_snapshot_ptr load_snapshot() const;
+  state_node_ptr get_node_at_revision( const index_snapshot& snapshot,
+                                       uint64_t revision,
+                                       const state_node_id& child_id,
+                                       const shared_lock_ptr& lock ) const;
+  state_node_ptr get_common_ancestor( const index_snapshot& snapshot,
+                                      const state_node_id& a,
+                                      const state_node_id& b,
+                                      const shared_lock_ptr& lock ) const;
 
   bool is_open() const;
 
   std::optional< std::filesystem::path > _path;
   genesis_init_function _init_func     = nullptr;
   state_node_comparator_function _comp = nullptr;
+  state_db_options _options;
+
+  // Set when _comp is one of the built in comparators, which are resolved on _fork_heads directly
+  std::optional< fork_resolution_algorithm > _fork_choice;
 
   state_multi_index_type _index;
+  snapshot_index _snapshot_index; // The nodes of _index, sharing shards with published snapshots
   state_delta_ptr _head;
-  std::map< state_node_id, state_delta_ptr > _fork_heads;
+  fork_heads_multi_index_type _fork_heads;
   state_delta_ptr _root;
 
+  // The write of the root that is being committed in the background, if any
+  std::shared_future< void > _pending_commit;
+
+  // What readers see of the members above. Only loaded and stored with std::atomic_load and
+  // std::atomic_store.
+  index_snapshot_ptr _snapshot;
+
   /* Regarding mutexes used for synchronizing state_db...
    *
    * There are three mutexes that can be locked. They are:
-   *   - _index_mutex (locks access to _index)
+   *   - _index_mutex (locks access to _index, readers read _snapshot instead)
    *   - _node_mutex (locks access to creating new state_node_ptrs)
    *   - state_delta::cv_mutex() (locks access to a state_delta cv)
    *
@@ -220,16 +511,52 @@ public:
   mutable std::timed_mutex _index_mutex;
   mutable std::shared_mutex _node_mutex;
   mutable std::shared_mutex _fork_heads_mutex;
+
+  // Slots counting the holds on _node_mutex. There is only ever one unique hold.
+  std::size_t _shared_slot_count = 0;
+  std::unique_ptr< lock_slot[] > _shared_slots;
+  mutable lock_slot _unique_slot;
 };
 
+database_impl::database_impl():
+    _shared_slot_count( std::max< std::size_t >( constants::min_shared_lock_slots,
+                                                 4 * std::thread::hardware_concurrency() ) ),
+    _shared_slots( std::make_unique< lock_slot[] >( _shared_slot_count ) )
+{
+  for( std::size_t i = 0; i < _shared_slot_count; ++i )
+    _shared_slots[ i ].mutex = &_node_mutex;
+
+  _unique_slot.mutex = &_node_mutex;
+}
+
 shared_lock_ptr database_impl::get_shared_lock() const
 {
-  return std::make_shared< std::shared_lock< std::shared_mutex > >( _node_mutex );
+  _node_mutex.lock_shared();
+
+  // Each thread starts looking for a free slot at its own, so threads rarely share a slot's line
+  const auto start = std::hash< std::thread::id >()( std::this_thread::get_id() );
+
+  for( std::size_t i = 0; i < _shared_slot_count; ++i )
+  {
+    auto& slot        = _shared_slots[ ( start + i ) % _shared_slot_count ];
+    uint32_t expected = 0;
+    if( slot.refs.compare_exchange_strong( expected, 1, std::memory_order_acquire ) )
+      return shared_lock_ptr( &slot );
+  }
+
+  // Every slot is held, this hold gets a slot of its own
+  auto slot    = new lock_slot();
+  slot->refs   = 1;
+  slot->mutex  = &_node_mutex;
+  slot->pooled = false;
+  return shared_lock_ptr( slot );
 }
 
 unique_lock_ptr database_impl::get_unique_lock() const
 {
-  return std::make_shared< std::unique_lock< std::shared_mutex > >( _node_mutex );
+  _node_mutex.lock();
+  _unique_slot.refs.store( 1, std::memory_order_relaxed );
+  return unique_lock_ptr( &_unique_slot );
 }
 
 bool database_impl::verify_shared_lock( const shared_lock_ptr& lock ) const
@@ -237,10 +564,7 @@ bool database_impl::verify_shared_lock( const shared_lock_ptr& lock ) const
   if( !lock )
     return false;
 
-  if( !lock->owns_lock() )
-    return false;
-
-  return lock->mutex() == &_node_mutex;
+  return lock.mutex() == &_node_mutex;
 }
 
 bool database_impl::verify_unique_lock( const unique_lock_ptr& lock ) const
@@ -248,10 +572,7 @@ bool database_impl::verify_unique_lock( const unique_lock_ptr& lock ) const
   if( !lock )
     return false;
 
-  if( !lock->owns_lock() )
-    return false;
-
-  return lock->mutex() == &_node_mutex;
+  return lock.mutex() == &_node_mutex;
 }
 
 void database_impl::reset( const unique_lock_ptr& lock )
@@ -266,15 +587,18 @@ void database_impl::reset( const unique_lock_ptr& lock )
   std::unique_lock< std::shared_mutex > fork_heads_lock( _fork_heads_mutex );
 
   KOINOS_ASSERT( is_open(), database_not_open, "database is not open" );
+  finish_commit_lockless();
+  write_root_lockless();
   // Wipe and start over from empty database!
   _root->clear();
   close_lockless();
-  open_lockless( _path, _init_func, _comp );
+  open_lockless( _path, _init_func, _comp, _options );
 }
 
 void database_impl::open( const std::optional< std::filesystem::path >& p,
                           genesis_init_function init,
                           fork_resolution_algorithm algo,
+                          const state_db_options& options,
                           const unique_lock_ptr& lock )
 {
   KOINOS_ASSERT( verify_unique_lock( lock ), illegal_argument, "database is not properly locked" );
@@ -295,40 +619,56 @@ void database_impl::open( const std::optional< std::filesystem::path >& p,
       comp = &fifo_comparator;
   }
 
-  open( p, init, comp, lock );
+  open( p, init, comp, options, lock );
 }
 
 void database_impl::open( const std::optional< std::filesystem::path >& p,
                           genesis_init_function init,
                           state_node_comparator_function comp,
+                          const state_db_options& options,
                           const unique_lock_ptr& lock )
 {
   KOINOS_ASSERT( verify_unique_lock( lock ), illegal_argument, "database is not properly locked" );
   std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
   std::unique_lock< std::shared_mutex > fork_heads_lock( _fork_heads_mutex );
-  open_lockless( p, init, comp );
+  open_lockless( p, init, comp, options );
 }
 
 void database_impl::open_lockless( const std::optional< std::filesystem::path >& p,
                                    genesis_init_function init,
-                                   state_node_comparator_function comp )
+                                   state_node_comparator_function comp,
+                                   const state_db_options& options )
 {
   auto root           = std::make_shared< state_node >();
-  root->_impl->_state = std::make_shared< state_delta >( p );
+  root->_impl->_state = std::make_shared< state_delta >( p, options );
   _init_func          = init;
   _comp               = comp;
+  _options            = options;
+  _fork_choice.reset();
+
+  if( auto target = _comp.target< comparator_pointer >(); target )
+  {
+    if( *target == &fifo_comparator )
+      _fork_choice = fork_resolution_algorithm::fifo;
+    else if( *target == &block_time_comparator )
+      _fork_choice = fork_resolution_algorithm::block_time;
+    else if( *target == &pob_comparator )
+      _fork_choice = fork_resolution_algorithm::pob;
+  }
 
   if( !root->revision() && root->_impl->_state->is_empty() && _init_func )
   {
     init( root );
   }
   root->_impl->_state->finalize();
-  _index.insert( root->_impl->_state );
+  insert_node_lockless( root->_impl->_state );
   _root = root->_impl->_state;
   _head = root->_impl->_state;
-  _fork_heads.insert_or_assign( _head->id(), _head );
+  _fork_heads.insert( _head );
 
   _path = p;
+
+  publish_snapshot_lockless();
 }
 
 void database_impl::close( const unique_lock_ptr& lock )
@@ -341,10 +681,43 @@ void database_impl::close( const unique_lock_ptr& lock )
 
 void database_impl::close_lockless()
 {
+  finish_commit_lockless();
+  write_root_lockless();
   _fork_heads.clear();
   _root.reset();
   _head.reset();
   _index.clear();
+  _snapshot_index.clear();
+
+  std::atomic_store( &_snapshot, index_snapshot_ptr() );
+}
+
+bool database_impl::insert_node_lockless( const state_delta_ptr& delta )
+{
+  if( !_index.insert( delta ).second )
+    return false;
+
+  _snapshot_index.insert( delta );
+  return true;
+}
+
+void database_impl::publish_snapshot_lockless()
+{
+  // Only the shards changed since the last publish are copied, the fork heads are few
+  auto snapshot   = std::make_shared< index_snapshot >();
+  snapshot->head  = _head;
+  snapshot->root  = _root;
+  snapshot->index = _snapshot_index.publish();
+  snapshot->fork_heads.assign( _fork_heads.begin(), _fork_heads.end() );
+
+  std::atomic_store( &_snapshot, index_snapshot_ptr( std::move( snapshot ) ) );
+}
+
+index_snapshot_ptr database_impl::load_snapshot() const
+{
+  auto snapshot = std::atomic_load( &_snapshot );
+  KOINOS_ASSERT( snapshot, database_not_open, "database is not open" );
+  return snapshot;
 }
 
 state_node_ptr database_impl::get_node_at_revision( uint64_t revision,
@@ -352,108 +725,117 @@ state_node_ptr database_impl::get_node_at_revision( uint64_t revision,
                                                     const shared_lock_ptr& lock ) const
 {
   KOINOS_ASSERT( verify_shared_lock( lock ), illegal_argument, "database is not properly locked" );
-  std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
-  KOINOS_ASSERT( is_open(), database_not_open, "database is not open" );
-  KOINOS_ASSERT( revision >= _root->revision(),
-                 illegal_argument,
-                 "cannot ask for node with revision less than root. root rev: ${root}, requested: ${req}",
-                 ( "root", _root->revision() )( "req", revision ) );
 
-  if( revision == _root->revision() )
-  {
-    auto root = get_root_lockless();
-    if( root )
-      root->_impl->_lock = lock;
+  return get_node_at_revision( *load_snapshot(), revision, child_id, lock );
+}
 
-    return root;
-  }
+state_node_ptr database_impl::get_node_at_revision( uint64_t revision,
+                                                    const state_node_id& child_id,
+                                                    const unique_lock_ptr& lock ) const
+{
+  KOINOS_ASSERT( verify_unique_lock( lock ), illegal_argument, "database is not properly locked" );
 
-  auto child = get_node_lockless( child_id );
-  if( !child )
-    child = get_head_lockless();
+  return get_node_at_revision( *load_snapshot(), revision, child_id, shared_lock_ptr() );
+}
 
-  state_delta_ptr delta = child->_impl->_state;
+state_node_ptr database_impl::get_node_at_revision( const index_snapshot& snapshot,
+                                                    uint64_t revision,
+                                                    const state_node_id& child_id,
+                                                    const shared_lock_ptr& lock ) const
+{
+  KOINOS_ASSERT( revision >= snapshot.root->revision(),
+                 illegal_argument,
+                 "cannot ask for node with revision less than root. root rev: ${root}, requested: ${req}",
+                 ( "root", snapshot.root->revision() )( "req", revision ) );
 
-  while( delta->revision() > revision )
+  if( revision == snapshot.root->revision() )
   {
-    delta = delta->parent();
+    return node_handle( snapshot.root, lock );
   }
 
-  auto node_itr = _index.find( delta->id() );
+  auto delta = snapshot.index.find( child_id );
+  if( !delta )
+    delta = snapshot.head;
+
+  if( delta->revision() > revision )
+    delta = delta->ancestor( revision );
 
-  KOINOS_ASSERT( node_itr != _index.end(),
+  auto node = snapshot.index.find( delta->id() );
+
+  KOINOS_ASSERT( node,
                  internal_error,
                  "could not find state node associated with linked state_delta ${id}",
                  ( "id", delta->id() ) );
 
-  auto node           = std::make_shared< state_node >();
-  node->_impl->_state = *node_itr;
-  node->_impl->_lock  = lock;
-  return node;
+  return node_handle( node, lock );
 }
 
-state_node_ptr database_impl::get_node_at_revision( uint64_t revision,
-                                                    const state_node_id& child_id,
-                                                    const unique_lock_ptr& lock ) const
+state_node_ptr
+database_impl::get_common_ancestor( const state_node_id& a, const state_node_id& b, const shared_lock_ptr& lock ) const
 {
-  KOINOS_ASSERT( verify_unique_lock( lock ), illegal_argument, "database is not properly locked" );
-  std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
-  KOINOS_ASSERT( is_open(), database_not_open, "database is not open" );
-  KOINOS_ASSERT( revision >= _root->revision(),
-                 illegal_argument,
-                 "cannot ask for node with revision less than root. root rev: ${root}, requested: ${req}",
-                 ( "root", _root->revision() )( "req", revision ) );
+  KOINOS_ASSERT( verify_shared_lock( lock ), illegal_argument, "database is not properly locked" );
 
-  if( revision == _root->revision() )
-  {
-    auto root = get_root_lockless();
+  return get_common_ancestor( *load_snapshot(), a, b, lock );
+}
 
-    return root;
-  }
+state_node_ptr
+database_impl::get_common_ancestor( const state_node_id& a, const state_node_id& b, const unique_lock_ptr& lock ) const
+{
+  KOINOS_ASSERT( verify_unique_lock( lock ), illegal_argument, "database is not properly locked" );
 
-  auto child = get_node_lockless( child_id );
-  if( !child )
-    child = get_head_lockless();
+  return get_common_ancestor( *load_snapshot(), a, b, shared_lock_ptr() );
+}
 
-  state_delta_ptr delta = child->_impl->_state;
+state_node_ptr database_impl::get_common_ancestor( const index_snapshot& snapshot,
+                                                   const state_node_id& a,
+                                                   const state_node_id& b,
+                                                   const shared_lock_ptr& lock ) const
+{
+  auto a_delta = snapshot.index.find( a );
+  auto b_delta = snapshot.index.find( b );
 
-  while( delta->revision() > revision )
-  {
-    delta = delta->parent();
-  }
+  if( !a_delta || !b_delta )
+    return state_node_ptr();
+
+  auto delta = state_delta::common_ancestor( a_delta, b_delta );
+  KOINOS_ASSERT( delta, internal_error, "nodes ${a} and ${b} have no common ancestor", ( "a", a )( "b", b ) );
 
-  auto node_itr = _index.find( delta->id() );
+  auto node = snapshot.index.find( delta->id() );
 
-  KOINOS_ASSERT( node_itr != _index.end(),
+  KOINOS_ASSERT( node,
                  internal_error,
                  "could not find state node associated with linked state_delta ${id}",
                  ( "id", delta->id() ) );
 
-  auto node           = std::make_shared< state_node >();
-  node->_impl->_state = *node_itr;
-  return node;
+  return node_handle( node, lock );
 }
 
 state_node_ptr database_impl::get_node( const state_node_id& node_id, const shared_lock_ptr& lock ) const
 {
   KOINOS_ASSERT( verify_shared_lock( lock ), illegal_argument, "database is not properly locked" );
-  std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
 
-  auto node = get_node_lockless( node_id );
-  if( node )
-    node->_impl->_lock = lock;
+  auto delta = load_snapshot()->index.find( node_id );
 
-  return node;
+  if( delta )
+  {
+    return node_handle( delta, lock );
+  }
+
+  return state_node_ptr();
 }
 
 state_node_ptr database_impl::get_node( const state_node_id& node_id, const unique_lock_ptr& lock ) const
 {
   KOINOS_ASSERT( verify_unique_lock( lock ), illegal_argument, "database is not properly locked" );
-  std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
 
-  auto node = get_node_lockless( node_id );
+  auto delta = load_snapshot()->index.find( node_id );
 
-  return node;
+  if( delta )
+  {
+    return node_handle( delta );
+  }
+
+  return state_node_ptr();
 }
 
 state_node_ptr database_impl::get_node_lockless( const state_node_id& node_id ) const
@@ -464,14 +846,22 @@ state_node_ptr database_impl::get_node_lockless( const state_node_id& node_id )
 
   if( node_itr != _index.end() )
   {
-    auto node           = std::make_shared< state_node >();
-    node->_impl->_state = *node_itr;
-    return node;
+    return node_handle( *node_itr );
   }
 
   return state_node_ptr();
 }
 
+state_node_ptr database_impl::node_handle( const state_delta_ptr& delta, const shared_lock_ptr& lock )
+{
+  // Every lookup hands out its own node, which holds the caller's lock for as long as it is alive
+  auto node           = std::make_shared< state_node >();
+  node->_impl->_state = delta;
+  node->_impl->_lock  = lock;
+
+  return node;
+}
+
 state_node_ptr database_impl::create_writable_node( const state_node_id& parent_id,
                                                     const state_node_id& new_id,
                                                     const protocol::block_header& header,
@@ -503,17 +893,15 @@ state_node_ptr database_impl::create_writable_node( const state_node_id& parent_
       // Finally, if the node is finalized, we can create a new writable node with the desired parent
       if( is_finalized )
       {
-        auto node           = std::make_shared< state_node >();
-        node->_impl->_state = parent_state->_impl->_state->make_child( new_id, header );
+        auto delta = parent_state->_impl->_state->make_child( new_id, header );
 
         std::unique_lock< std::timed_mutex > index_lock( _index_mutex, timeout );
 
         // Ensure the parent node still exists in the index and then insert the child node
-        if( index_lock.owns_lock() && _index.find( parent_id ) != _index.end()
-            && _index.insert( node->_impl->_state ).second )
+        if( index_lock.owns_lock() && _index.find( parent_id ) != _index.end() && insert_node_lockless( delta ) )
         {
-          node->_impl->_lock = lock;
-          return node;
+          publish_snapshot_lockless();
+          return node_handle( delta, lock );
         }
       }
     }
@@ -553,16 +941,15 @@ state_node_ptr database_impl::create_writable_node( const state_node_id& parent_
       // Finally, if the node is finalized, we can create a new writable node with the desired parent
       if( is_finalized )
       {
-        auto node           = std::make_shared< state_node >();
-        node->_impl->_state = parent_state->_impl->_state->make_child( new_id, header );
+        auto delta = parent_state->_impl->_state->make_child( new_id, header );
 
         std::unique_lock< std::timed_mutex > index_lock( _index_mutex, timeout );
 
         // Ensure the parent node still exists in the index and then insert the child node
-        if( index_lock.owns_lock() && _index.find( parent_id ) != _index.end()
-            && _index.insert( node->_impl->_state ).second )
+        if( index_lock.owns_lock() && _index.find( parent_id ) != _index.end() && insert_node_lockless( delta ) )
         {
-          return node;
+          publish_snapshot_lockless();
+          return node_handle( delta );
         }
       }
     }
@@ -584,13 +971,12 @@ state_node_ptr database_impl::clone_node( const state_node_id& node_id,
   KOINOS_ASSERT( node, illegal_argument, "node ${n} not found.", ( "n", node_id ) );
   KOINOS_ASSERT( !node->is_finalized(), illegal_argument, "cannot clone finalized node" );
 
-  auto new_node           = std::make_shared< state_node >();
-  new_node->_impl->_state = node->_impl->_state->clone( new_id, header );
+  auto delta = node->_impl->_state->clone( new_id, header );
 
-  if( _index.insert( new_node->_impl->_state ).second )
+  if( insert_node_lockless( delta ) )
   {
-    new_node->_impl->_lock = lock;
-    return new_node;
+    publish_snapshot_lockless();
+    return node_handle( delta, lock );
   }
 
   return state_node_ptr();
@@ -609,12 +995,12 @@ state_node_ptr database_impl::clone_node( const state_node_id& node_id,
   KOINOS_ASSERT( node, illegal_argument, "node ${n} not found.", ( "n", node_id ) );
   KOINOS_ASSERT( !node->is_finalized(), illegal_argument, "cannot clone finalized node" );
 
-  auto new_node           = std::make_shared< state_node >();
-  new_node->_impl->_state = node->_impl->_state->clone( new_id, header );
+  auto delta = node->_impl->_state->clone( new_id, header );
 
-  if( _index.insert( new_node->_impl->_state ).second )
+  if( insert_node_lockless( delta ) )
   {
-    return new_node;
+    publish_snapshot_lockless();
+    return node_handle( delta );
   }
 
   return state_node_ptr();
@@ -643,30 +1029,18 @@ void database_impl::finalize_node( const state_node_id& node_id, const shared_lo
   else if( node->revision() == _head->revision() )
   {
     std::unique_lock< std::shared_mutex > fork_heads_lock( _fork_heads_mutex );
-    fork_list forks;
-    forks.reserve( _fork_heads.size() );
-    std::transform( std::begin( _fork_heads ),
-                    std::end( _fork_heads ),
-                    std::back_inserter( forks ),
-                    []( const auto& entry )
-                    {
-                      state_node_ptr s = std::make_shared< state_node >();
-                      s->_impl->_state = entry.second;
-                      return s;
-                    } );
-
     auto head = get_head_lockless();
-    if( auto new_head = _comp( forks, head, node ); new_head != nullptr )
+    if( auto new_head = resolve_fork_lockless( head, node ); new_head != nullptr )
     {
       _head = new_head->_impl->_state;
     }
     else
     {
-      _head         = head->parent()->_impl->_state;
+      _head         = head->_impl->_state->parent();
       auto head_itr = _fork_heads.find( head->id() );
       if( head_itr != std::end( _fork_heads ) )
         _fork_heads.erase( head_itr );
-      _fork_heads.insert_or_assign( head->parent()->id(), _head );
+      _fork_heads.insert( _head );
     }
   }
 
@@ -678,8 +1052,10 @@ void database_impl::finalize_node( const state_node_id& node_id, const shared_lo
     if( parent_itr != std::end( _fork_heads ) )
       _fork_heads.erase( parent_itr );
 
-    _fork_heads.insert_or_assign( node->id(), node->_impl->_state );
+    _fork_heads.insert( node->_impl->_state );
   }
+
+  publish_snapshot_lockless();
 }
 
 void database_impl::finalize_node( const state_node_id& node_id, const unique_lock_ptr& lock )
@@ -705,30 +1081,18 @@ void database_impl::finalize_node( const state_node_id& node_id, const unique_lo
   else if( node->revision() == _head->revision() )
   {
     std::unique_lock< std::shared_mutex > fork_heads_lock( _fork_heads_mutex );
-    fork_list forks;
-    forks.reserve( _fork_heads.size() );
-    std::transform( std::begin( _fork_heads ),
-                    std::end( _fork_heads ),
-                    std::back_inserter( forks ),
-                    []( const auto& entry )
-                    {
-                      state_node_ptr s = std::make_shared< state_node >();
-                      s->_impl->_state = entry.second;
-                      return s;
-                    } );
-
     auto head = get_head_lockless();
-    if( auto new_head = _comp( forks, head, node ); new_head != nullptr )
+    if( auto new_head = resolve_fork_lockless( head, node ); new_head != nullptr )
     {
       _head = new_head->_impl->_state;
     }
     else
     {
-      _head         = head->parent()->_impl->_state;
+      _head         = head->_impl->_state->parent();
       auto head_itr = _fork_heads.find( head->id() );
       if( head_itr != std::end( _fork_heads ) )
         _fork_heads.erase( head_itr );
-      _fork_heads.insert_or_assign( head->parent()->id(), _head );
+      _fork_heads.insert( _head );
     }
   }
 
@@ -740,8 +1104,42 @@ void database_impl::finalize_node( const state_node_id& node_id, const unique_lo
     if( parent_itr != std::end( _fork_heads ) )
       _fork_heads.erase( parent_itr );
 
-    _fork_heads.insert_or_assign( node->id(), node->_impl->_state );
+    _fork_heads.insert( node->_impl->_state );
   }
+
+  publish_snapshot_lockless();
+}
+
+state_node_ptr database_impl::resolve_fork_lockless( const state_node_ptr& head, const state_node_ptr& node ) const
+{
+  // A user supplied comparator is handed every fork head
+  if( !_fork_choice )
+  {
+    fork_list forks;
+    forks.reserve( _fork_heads.size() );
+    for( const auto& fork_head: _fork_heads )
+      forks.push_back( node_handle( fork_head ) );
+
+    return _comp( forks, head, node );
+  }
+
+  if( *_fork_choice == fork_resolution_algorithm::fifo )
+    return head;
+
+  if( *_fork_choice == fork_resolution_algorithm::block_time
+      || head->block_header().signer() != node->block_header().signer() )
+    return node->block_header().timestamp() < head->block_header().timestamp() ? node : head;
+
+  // Fork heads are kept in priority order, so the best fork other than head is one of the first two
+  const auto& priority_idx = _fork_heads.get< by_priority >();
+  auto best_itr            = priority_idx.begin();
+  if( best_itr != priority_idx.end() && ( *best_itr )->id() == head->id() )
+    ++best_itr;
+
+  if( best_itr == priority_idx.end() || fork_priority()( head->_impl->_state->parent(), *best_itr ) )
+    return state_node_ptr();
+
+  return node_handle( *best_itr );
 }
 
 void database_impl::discard_node( const state_node_id& node_id,
@@ -752,6 +1150,7 @@ void database_impl::discard_node( const state_node_id& node_id,
   std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
   std::unique_lock< std::shared_mutex > fork_heads_lock( _fork_heads_mutex );
   discard_node_lockless( node_id, whitelist );
+  publish_snapshot_lockless();
 }
 
 void database_impl::discard_node( const state_node_id& node_id,
@@ -762,6 +1161,7 @@ void database_impl::discard_node( const state_node_id& node_id,
   std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
   std::unique_lock< std::shared_mutex > fork_heads_lock( _fork_heads_mutex );
   discard_node_lockless( node_id, whitelist );
+  publish_snapshot_lockless();
 }
 
 void database_impl::discard_node_lockless( const state_node_id& node_id,
@@ -785,16 +1185,14 @@ void database_impl::discard_node_lockless( const state_node_id& node_id,
                    cannot_discard,
                    "cannot discard a node that would result in discarding of head" );
 
-    auto previtr = previdx.lower_bound( remove_queue[ i ] );
-    while( previtr != previdx.end() && ( *previtr )->parent_id() == remove_queue[ i ] )
+    auto [ previtr, prevend ] = previdx.equal_range( remove_queue[ i ] );
+    for( ; previtr != prevend; ++previtr )
     {
       // Do not remove nodes on the whitelist
       if( whitelist.find( ( *previtr )->id() ) == whitelist.end() )
       {
         remove_queue.push_back( ( *previtr )->id() );
       }
-
-      ++previtr;
     }
 
     // We may discard one or more fork heads when discarding a minority fork tree
@@ -810,16 +1208,23 @@ void database_impl::discard_node_lockless( const state_node_id& node_id,
   {
     auto itr = _index.find( id );
     if( itr != _index.end() )
+    {
       _index.erase( itr );
+      _snapshot_index.erase( id );
+    }
   }
 
+  // A discarded root has no parent, as when a commit that is still being written replaces it
+  if( node->_impl->_state->is_root() )
+    return;
+
   // When node is discarded, if the parent node is not a parent of other nodes (no forks), add it to heads.
   auto fork_itr = previdx.find( node->parent_id() );
   if( fork_itr == previdx.end() )
   {
     auto parent_itr = _index.find( node->parent_id() );
     KOINOS_ASSERT( parent_itr != _index.end(), internal_error, "discarded parent node not found in node index" );
-    _fork_heads.insert_or_assign( ( *parent_itr )->id(), *parent_itr );
+    _fork_heads.insert( *parent_itr );
   }
 }
 
@@ -830,72 +1235,185 @@ void database_impl::commit_node( const state_node_id& node_id, const unique_lock
   std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
   std::unique_lock< std::shared_mutex > fork_heads_lock( _fork_heads_mutex );
   KOINOS_ASSERT( is_open(), database_not_open, "database is not open" );
+  finish_commit_lockless();
+  commit_node_lockless( node_id );
+}
 
-  // If the node_id to commit is the root id, return. It is already committed.
+void database_impl::commit_node_lockless( const state_node_id& node_id )
+{
+  // If the node_id to commit is the root id, it is already committed unless its write failed
   if( node_id == _root->id() )
+  {
+    write_root_lockless();
     return;
+  }
 
   auto node = get_node_lockless( node_id );
   KOINOS_ASSERT( node, illegal_argument, "node ${n} not found", ( "n", node_id ) );
 
+  // A failed write leaves the index and root as they were
+  commit_delta_lockless( node_id );
+
   auto old_root = _root;
   _root         = node->_impl->_state;
 
-  _index.modify( _index.find( node_id ),
+  std::unordered_set< state_node_id > whitelist{ node_id };
+  discard_node_lockless( old_root->id(), whitelist );
+  publish_snapshot_lockless();
+}
+
+std::shared_future< void > database_impl::commit_node_async( const state_node_id& node_id, const unique_lock_ptr& lock )
+{
+  KOINOS_ASSERT( verify_unique_lock( lock ), illegal_argument, "database is not properly locked" );
+  std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
+  std::unique_lock< std::shared_mutex > fork_heads_lock( _fork_heads_mutex );
+  KOINOS_ASSERT( is_open(), database_not_open, "database is not open" );
+
+  // Only one commit is written at a time
+  finish_commit_lockless();
+
+  // Readers read an in memory root backend directly, so it is not written while they read it
+  if( !_path )
+  {
+    std::promise< void > committed;
+
+    try
+    {
+      commit_node_lockless( node_id );
+      committed.set_value();
+    }
+    catch( ... )
+    {
+      committed.set_exception( std::current_exception() );
+    }
+
+    return committed.get_future().share();
+  }
+
+  // If the node_id to commit is the root id, it is already committed unless its write failed
+  if( node_id == _root->id() && _root->is_root() )
+  {
+    std::promise< void > committed;
+    committed.set_value();
+    return committed.get_future().share();
+  }
+
+  auto state = _root;
+
+  if( node_id != _root->id() )
+  {
+    auto node = get_node_lockless( node_id );
+    KOINOS_ASSERT( node, illegal_argument, "node ${n} not found", ( "n", node_id ) );
+    KOINOS_ASSERT( node->is_finalized(), illegal_argument, "cannot asynchronously commit a writable node" );
+
+    // The node is frozen, computing its merkle root here leaves the writer nothing to modify
+    state = node->_impl->_state;
+    state->merkle_root();
+
+    // The node is the root from now on. Until the write is finished readers read through the deltas
+    // between the old root and the node, which remain in place with the old root's backend beneath.
+    auto old_root = _root;
+    _root         = state;
+
+    std::unordered_set< state_node_id > whitelist{ node_id };
+    discard_node_lockless( old_root->id(), whitelist );
+    publish_snapshot_lockless();
+  }
+
+  _pending_commit = std::async( std::launch::async,
+                                [ state ]()
+                                {
+                                  state->write_commit();
+                                } )
+                      .share();
+
+  return _pending_commit;
+}
+
+void database_impl::finish_commit_lockless()
+{
+  if( !_pending_commit.valid() )
+    return;
+
+  try
+  {
+    _pending_commit.get();
+  }
+  catch( ... )
+  {
+    /**
+     * The failure was reported through the future returned by commit_node_async and the write
+     * batch was abandoned. The root keeps its parent, so its deltas remain in place above the
+     * stored root and the next commit, or closing the database, writes them again.
+     */
+    _pending_commit = std::shared_future< void >();
+    return;
+  }
+
+  _pending_commit = std::shared_future< void >();
+
+  // Finishing the commit removes the root's parent, which the index is keyed by
+  _index.modify( _index.find( _root->id() ),
                  []( state_delta_ptr& n )
                  {
-                   n->commit();
+                   n->finish_commit();
                  } );
+}
 
-  std::unordered_set< state_node_id > whitelist{ node_id };
-  discard_node_lockless( old_root->id(), whitelist );
+void database_impl::write_root_lockless()
+{
+  // Only a root whose asynchronous write failed still has deltas beneath it
+  if( !_root || _root->is_root() )
+    return;
+
+  commit_delta_lockless( _root->id() );
+}
+
+void database_impl::commit_delta_lockless( const state_node_id& node_id )
+{
+  auto itr = _index.find( node_id );
+
+  // The write throws before the delta is changed. Only the delta's parent changes after it, which
+  // the index is keyed by, so only that step is done inside modify, which drops a node that throws.
+  ( *itr )->write_commit();
+
+  _index.modify( itr,
+                 []( state_delta_ptr& n )
+                 {
+                   n->finish_commit();
+                 } );
 }
 
 state_node_ptr database_impl::get_head( const shared_lock_ptr& lock ) const
 {
   KOINOS_ASSERT( verify_shared_lock( lock ), illegal_argument, "database is not properly locked" );
-  std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
 
-  auto head = get_head_lockless();
-  if( head )
-    head->_impl->_lock = lock;
-
-  return head;
+  return node_handle( load_snapshot()->head, lock );
 }
 
 state_node_ptr database_impl::get_head( const unique_lock_ptr& lock ) const
 {
   KOINOS_ASSERT( verify_unique_lock( lock ), illegal_argument, "database is not properly locked" );
-  std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
 
-  auto head = get_head_lockless();
-
-  return head;
+  return node_handle( load_snapshot()->head );
 }
 
 state_node_ptr database_impl::get_head_lockless() const
 {
   KOINOS_ASSERT( is_open(), database_not_open, "database is not open" );
-  auto head           = std::make_shared< state_node >();
-  head->_impl->_state = _head;
-  return head;
+  return node_handle( _head );
 }
 
 std::vector< state_node_ptr > database_impl::get_fork_heads( const shared_lock_ptr& lock ) const
 {
   KOINOS_ASSERT( verify_shared_lock( lock ), illegal_argument, "database is not properly locked" );
-  std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
-  std::shared_lock< std::shared_mutex > fork_heads_lock( _fork_heads_mutex );
-  KOINOS_ASSERT( is_open(), database_not_open, "database is not open" );
+  auto snapshot = load_snapshot();
   std::vector< state_node_ptr > fork_heads;
-  fork_heads.reserve( _fork_heads.size() );
+  fork_heads.reserve( snapshot->fork_heads.size() );
 
-  for( auto& head: _fork_heads )
+  for( auto& head: snapshot->fork_heads )
   {
-    auto fork_head           = std::make_shared< state_node >();
-    fork_head->_impl->_state = head.second;
-    fork_head->_impl->_lock  = lock;
-    fork_heads.push_back( fork_head );
+    fork_heads.push_back( node_handle( head, lock ) );
   }
 
   return fork_heads;
@@ -904,17 +1422,13 @@ std::vector< state_node_ptr > database_impl::get_fork_heads( const shared_lock_p
 std::vector< state_node_ptr > database_impl::get_fork_heads( const unique_lock_ptr& lock ) const
 {
   KOINOS_ASSERT( verify_unique_lock( lock ), illegal_argument, "database is not properly locked" );
-  std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
-  std::shared_lock< std::shared_mutex > fork_heads_lock( _fork_heads_mutex );
-  KOINOS_ASSERT( is_open(), database_not_open, "database is not open" );
+  auto snapshot = load_snapshot();
   std::vector< state_node_ptr > fork_heads;
-  fork_heads.reserve( _fork_heads.size() );
+  fork_heads.reserve( snapshot->fork_heads.size() );
 
-  for( auto& head: _fork_heads )
+  for( auto& head: snapshot->fork_heads )
   {
-    auto fork_head           = std::make_shared< state_node >();
-    fork_head->_impl->_state = head.second;
-    fork_heads.push_back( fork_head );
+    fork_heads.push_back( node_handle( head ) );
   }
 
   return fork_heads;
@@ -923,17 +1437,13 @@ std::vector< state_node_ptr > database_impl::get_fork_heads( const unique_lock_p
 std::vector< state_node_ptr > database_impl::get_all_nodes( const shared_lock_ptr& lock ) const
 {
   KOINOS_ASSERT( verify_shared_lock( lock ), illegal_argument, "database is not properly locked" );
-  std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
-  KOINOS_ASSERT( is_open(), database_not_open, "database is not open" );
+  auto snapshot = load_snapshot();
   std::vector< state_node_ptr > nodes;
-  nodes.reserve( _index.size() );
+  nodes.reserve( snapshot->index.size() );
 
-  for( const auto& delta: _index )
+  for( const auto& delta: sorted_by_id( snapshot->index ) )
   {
-    auto node           = std::make_shared< state_node >();
-    node->_impl->_state = delta;
-    node->_impl->_lock  = lock;
-    nodes.push_back( node );
+    nodes.push_back( node_handle( delta, lock ) );
   }
 
   return nodes;
@@ -942,16 +1452,13 @@ std::vector< state_node_ptr > database_impl::get_all_nodes( const shared_lock_pt
 std::vector< state_node_ptr > database_impl::get_all_nodes( const unique_lock_ptr& lock ) const
 {
   KOINOS_ASSERT( verify_unique_lock( lock ), illegal_argument, "database is not properly locked" );
-  std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
-  KOINOS_ASSERT( is_open(), database_not_open, "database is not open" );
+  auto snapshot = load_snapshot();
   std::vector< state_node_ptr > nodes;
-  nodes.reserve( _index.size() );
+  nodes.reserve( snapshot->index.size() );
 
-  for( const auto& delta: _index )
+  for( const auto& delta: sorted_by_id( snapshot->index ) )
   {
-    auto node           = std::make_shared< state_node >();
-    node->_impl->_state = delta;
-    nodes.push_back( node );
+    nodes.push_back( node_handle( delta ) );
   }
 
   return nodes;
@@ -960,31 +1467,15 @@ std::vector< state_node_ptr > database_impl::get_all_nodes( const unique_lock_pt
 state_node_ptr database_impl::get_root( const shared_lock_ptr& lock ) const
 {
   KOINOS_ASSERT( verify_shared_lock( lock ), illegal_argument, "database is not properly locked" );
-  std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
 
-  auto root = get_root_lockless();
-  if( root )
-    root->_impl->_lock = lock;
-
-  return root;
+  return node_handle( load_snapshot()->root, lock );
 }
 
 state_node_ptr database_impl::get_root( const unique_lock_ptr& lock ) const
 {
   KOINOS_ASSERT( verify_unique_lock( lock ), illegal_argument, "database is not properly locked" );
-  std::lock_guard< std::timed_mutex > index_lock( _index_mutex );
 
-  auto root = get_root_lockless();
-
-  return root;
-}
-
-state_node_ptr database_impl::get_root_lockless() const
-{
-  KOINOS_ASSERT( is_open(), database_not_open, "database is not open" );
-  auto root           = std::make_shared< state_node >();
-  root->_impl->_state = _root;
-  return root;
+  return node_handle( load_snapshot()->root );
 }
 
 bool database_impl::is_open() const
@@ -992,30 +1483,29 @@ bool database_impl::is_open() const
   return (bool)_root && (bool)_head;
 }
 
-const object_value* state_node_impl::get_object( const object_space& space, const object_key& key ) const
+value_handle state_node_impl::get_object( const object_space& space, const object_key& key ) const
 {
-  chain::database_key db_key;
-  *db_key.mutable_space() = space;
-  db_key.set_key( key );
-  auto key_string = util::converter::as< std::string >( db_key );
+  auto key_string = detail::key_codec( space ).encode( key );
 
-  auto pobj = merge_state( _state ).find( key_string );
+  return merge_state( _state ).find( key_string );
+}
 
-  if( pobj != nullptr )
-  {
-    return pobj;
-  }
+std::vector< value_handle > state_node_impl::get_objects( const std::vector< object_space_key >& keys ) const
+{
+  std::vector< std::string > key_strings;
+  key_strings.reserve( keys.size() );
+
+  for( const auto& [ space, key ]: keys )
+    key_strings.push_back( detail::key_codec( space ).encode( key ) );
 
-  return nullptr;
+  return merge_state( _state ).find_many( key_strings );
 }
 
-std::pair< const object_value*, const object_key > state_node_impl::get_next_object( const object_space& space,
-                                                                                     const object_key& key ) const
+std::pair< value_handle, const object_key > state_node_impl::get_next_object( const object_space& space,
+                                                                              const object_key& key ) const
 {
-  chain::database_key db_key;
-  *db_key.mutable_space() = space;
-  db_key.set_key( key );
-  auto key_string = util::converter::as< std::string >( db_key );
+  detail::key_codec codec( space );
+  auto key_string = codec.encode( key );
 
   auto state = merge_state( _state );
   auto it    = state.lower_bound( key_string );
@@ -1027,24 +1517,22 @@ std::pair< const object_value*, const object_key > state_node_impl::get_next_obj
 
   if( it != state.end() )
   {
-    chain::database_key next_key = util::converter::to< chain::database_key >( it.key() );
+    object_key next_key;
 
-    if( next_key.space() == space )
+    if( codec.decode( it.key(), next_key ) )
     {
-      return { &*it, next_key.key() };
+      return { it.handle(), next_key };
     }
   }
 
   return { nullptr, null_key };
 }
 
-std::pair< const object_value*, const object_key > state_node_impl::get_prev_object( const object_space& space,
-                                                                                     const object_key& key ) const
+std::pair< value_handle, const object_key > state_node_impl::get_prev_object( const object_space& space,
+                                                                              const object_key& key ) const
 {
-  chain::database_key db_key;
-  *db_key.mutable_space() = space;
-  db_key.set_key( key );
-  auto key_string = util::converter::as< std::string >( db_key );
+  detail::key_codec codec( space );
+  auto key_string = codec.encode( key );
 
   auto state = merge_state( _state );
   auto it    = state.lower_bound( key_string );
@@ -1052,11 +1540,11 @@ std::pair< const object_value*, const object_key > state_node_impl::get_prev_obj
   if( it != state.begin() )
   {
     --it;
-    chain::database_key next_key = util::converter::to< chain::database_key >( it.key() );
+    object_key next_key;
 
-    if( next_key.space() == space )
+    if( codec.decode( it.key(), next_key ) )
     {
-      return { &*it, next_key.key() };
+      return { it.handle(), next_key };
     }
   }
 
@@ -1067,10 +1555,7 @@ int64_t state_node_impl::put_object( const object_space& space, const object_key
 {
   KOINOS_ASSERT( !_state->is_finalized(), node_finalized, "cannot write to a finalized node" );
 
-  chain::database_key db_key;
-  *db_key.mutable_space() = space;
-  db_key.set_key( key );
-  auto key_string = util::converter::as< std::string >( db_key );
+  auto key_string = detail::key_codec( space ).encode( key );
 
   int64_t bytes_used = 0;
   auto pobj          = merge_state( _state ).find( key_string );
@@ -1081,7 +1566,7 @@ int64_t state_node_impl::put_object( const object_space& space, const object_key
     bytes_used += key_string.size();
 
   bytes_used += val->size();
-  _state->put( key_string, *val );
+  _state->put( key_string, *val, pobj != nullptr );
 
   return bytes_used;
 }
@@ -1090,10 +1575,7 @@ int64_t state_node_impl::remove_object( const object_space& space, const object_
 {
   KOINOS_ASSERT( !_state->is_finalized(), node_finalized, "cannot write to a finalized node" );
 
-  chain::database_key db_key;
-  *db_key.mutable_space() = space;
-  db_key.set_key( key );
-  auto key_string = util::converter::as< std::string >( db_key );
+  auto key_string = detail::key_codec( space ).encode( key );
 
   int64_t bytes_used = 0;
   auto pobj          = merge_state( _state ).find( key_string );
@@ -1104,7 +1586,7 @@ int64_t state_node_impl::remove_object( const object_space& space, const object_
     bytes_used -= key_string.size();
   }
 
-  _state->erase( key_string );
+  _state->erase( key_string, pobj != nullptr );
 
   return bytes_used;
 }
@@ -1119,27 +1601,158 @@ std::vector< protocol::state_delta_entry > state_node_impl::get_delta_entries()
   return _state->get_delta_entries();
 }
 
+state_cursor_impl::state_cursor_impl( state_delta_ptr state,
+                                      shared_lock_ptr lock,
+                                      const object_space& space,
+                                      const object_key& start,
+                                      const object_key& end,
+                                      scan_direction direction ):
+    _state( state ),
+    _lock( lock ),
+    _codec( space ),
+    _start( _codec.encode( start ) ),
+    _end( end.empty() ? _codec.upper_bound() : _codec.encode( end ) ),
+    _direction( direction )
+{
+  if( _direction == scan_direction::forward )
+  {
+    _itr.emplace( _state.lower_bound( _start ) );
+    _limit.emplace( _state.end() );
+  }
+  else
+  {
+    // Reverse scans start on the last object before the end of the range
+    _itr.emplace( _state.lower_bound( _end ) );
+    _limit.emplace( _state.begin() );
+
+    if( *_itr == *_limit )
+      return;
+
+    --( *_itr );
+  }
+
+  check_bounds();
+}
+
+bool state_cursor_impl::valid() const
+{
+  return _valid;
+}
+
+const object_key& state_cursor_impl::key() const
+{
+  KOINOS_ASSERT( _valid, illegal_argument, "cursor is not pointing to an object" );
+  return _key;
+}
+
+const object_value& state_cursor_impl::value() const
+{
+  KOINOS_ASSERT( _valid, illegal_argument, "cursor is not pointing to an object" );
+  return **_itr;
+}
+
+void state_cursor_impl::next()
+{
+  KOINOS_ASSERT( _valid, illegal_argument, "cursor is not pointing to an object" );
+
+  if( _direction == scan_direction::forward )
+  {
+    ++( *_itr );
+  }
+  else
+  {
+    if( *_itr == *_limit )
+    {
+      _valid = false;
+      return;
+    }
+
+    --( *_itr );
+  }
+
+  check_bounds();
+}
+
+void state_cursor_impl::check_bounds()
+{
+  _valid = false;
+
+  if( _direction == scan_direction::forward && *_itr == *_limit )
+    return;
+
+  const auto& key = _itr->key();
+
+  if( key < _start || key >= _end )
+    return;
+
+  _valid = _codec.decode( key, _key );
+}
+
 } // namespace detail
 
+state_cursor::state_cursor( std::unique_ptr< detail::state_cursor_impl > impl ):
+    _impl( std::move( impl ) )
+{}
+
+state_cursor::state_cursor( state_cursor&& other ) = default;
+
+state_cursor::~state_cursor() = default;
+
+state_cursor& state_cursor::operator=( state_cursor&& other ) = default;
+
+bool state_cursor::valid() const
+{
+  return _impl->valid();
+}
+
+const object_key& state_cursor::key() const
+{
+  return _impl->key();
+}
+
+const object_value& state_cursor::value() const
+{
+  return _impl->value();
+}
+
+void state_cursor::next()
+{
+  _impl->next();
+}
+
 abstract_state_node::abstract_state_node():
     _impl( new detail::state_node_impl() )
 {}
 
 abstract_state_node::~abstract_state_node() {}
 
-const object_value* abstract_state_node::get_object( const object_space& space, const object_key& key ) const
+value_handle abstract_state_node::get_object( const object_space& space, const object_key& key ) const
 {
   return _impl->get_object( space, key );
 }
 
-std::pair< const object_value*, const object_key > abstract_state_node::get_next_object( const object_space& space,
-                                                                                         const object_key& key ) const
+std::vector< value_handle > abstract_state_node::get_objects( const std::vector< object_space_key >& keys ) const
+{
+  return _impl->get_objects( keys );
+}
+
+state_cursor abstract_state_node::scan( const object_space& space,
+                                       const object_key& start,
+                                       const object_key& end,
+                                       scan_direction direction ) const
+{
+  return state_cursor(
+    std::make_unique< detail::state_cursor_impl >( _impl->_state, _impl->_lock, space, start, end, direction ) );
+}
+
+std::pair< value_handle, const object_key > abstract_state_node::get_next_object( const object_space& space,
+                                                                                  const object_key& key ) const
 {
   return _impl->get_next_object( space, key );
 }
 
-std::pair< const object_value*, const object_key > abstract_state_node::get_prev_object( const object_space& space,
-                                                                                         const object_key& key ) const
+std::pair< value_handle, const object_key > abstract_state_node::get_prev_object( const object_space& space,
+                                                                                  const object_key& key ) const
 {
   return _impl->get_prev_object( space, key );
 }
@@ -1205,10 +1818,7 @@ abstract_state_node_ptr state_node::parent() const
   auto parent_delta = _impl->_state->parent();
   if( parent_delta )
   {
-    auto parent_node           = std::make_shared< state_node >();
-    parent_node->_impl->_state = parent_delta;
-    parent_node->_impl->_lock  = _impl->_lock;
-    return parent_node;
+    return detail::database_impl::node_handle( parent_delta, _impl->_lock );
   }
 
   return abstract_state_node_ptr();
@@ -1296,37 +1906,108 @@ state_node_ptr pob_comparator( fork_list& forks, state_node_ptr head_block, stat
   if( it != std::end( forks ) )
     forks.erase( it );
 
-  struct
+  if( std::size( forks ) )
   {
-    bool operator()( abstract_state_node_ptr a, abstract_state_node_ptr b ) const
-    {
-      if( a->revision() > b->revision() )
-        return true;
-      else if( a->revision() < b->revision() )
-        return false;
+    it = std::min_element( std::begin( forks ), std::end( forks ), detail::fork_priority() );
+    return detail::fork_priority()( head_block->parent(), *it ) ? state_node_ptr() : *it;
+  }
 
-      if( a->block_header().timestamp() < b->block_header().timestamp() )
-        return true;
-      else if( a->block_header().timestamp() > b->block_header().timestamp() )
-        return false;
+  return state_node_ptr();
+}
 
-      if( a->id() < b->id() )
-        return true;
+template< bool Unique >
+lock_token< Unique >::lock_token( detail::lock_slot* slot ):
+    _slot( slot )
+{}
 
-      return false;
-    }
-  } priority_algorithm;
+template< bool Unique >
+lock_token< Unique >::lock_token( const lock_token& other ):
+    _slot( other._slot )
+{
+  if( _slot )
+    _slot->refs.fetch_add( 1, std::memory_order_relaxed );
+}
 
-  if( std::size( forks ) )
+template< bool Unique >
+lock_token< Unique >::lock_token( lock_token&& other ) noexcept:
+    _slot( other._slot )
+{
+  other._slot = nullptr;
+}
+
+template< bool Unique >
+lock_token< Unique >::~lock_token()
+{
+  reset();
+}
+
+template< bool Unique >
+lock_token< Unique >& lock_token< Unique >::operator=( const lock_token& other )
+{
+  if( _slot != other._slot )
   {
-    std::sort( std::begin( forks ), std::end( forks ), priority_algorithm );
-    it = std::begin( forks );
-    return priority_algorithm( head_block->parent(), *it ) ? state_node_ptr() : *it;
+    reset();
+    _slot = other._slot;
+    if( _slot )
+      _slot->refs.fetch_add( 1, std::memory_order_relaxed );
   }
 
-  return state_node_ptr();
+  return *this;
+}
+
+template< bool Unique >
+lock_token< Unique >& lock_token< Unique >::operator=( lock_token&& other ) noexcept
+{
+  if( this != &other )
+  {
+    reset();
+    _slot       = other._slot;
+    other._slot = nullptr;
+  }
+
+  return *this;
+}
+
+template< bool Unique >
+void lock_token< Unique >::reset()
+{
+  if( !_slot )
+    return;
+
+  auto slot = std::exchange( _slot, nullptr );
+
+  // A pooled slot may be claimed by another hold as soon as its count reaches zero, so everything
+  // needed to release the lock is read first
+  auto mutex  = slot->mutex;
+  auto pooled = slot->pooled;
+
+  if( slot->refs.fetch_sub( 1, std::memory_order_acq_rel ) != 1 )
+    return;
+
+  if constexpr( Unique )
+    mutex->unlock();
+  else
+    mutex->unlock_shared();
+
+  if( !pooled )
+    delete slot;
+}
+
+template< bool Unique >
+lock_token< Unique >::operator bool() const
+{
+  return _slot != nullptr;
+}
+
+template< bool Unique >
+const std::shared_mutex* lock_token< Unique >::mutex() const
+{
+  return _slot ? _slot->mutex : nullptr;
 }
 
+template class lock_token< false >;
+template class lock_token< true >;
+
 database::database():
     impl( new detail::database_impl() )
 {}
@@ -1348,15 +2029,33 @@ void database::open( const std::optional< std::filesystem::path >& p,
                      fork_resolution_algorithm algo,
                      const unique_lock_ptr& lock )
 {
-  impl->open( p, init, algo, lock ? lock : get_unique_lock() );
+  impl->open( p, init, algo, state_db_options(), lock ? lock : get_unique_lock() );
+}
+
+void database::open( const std::optional< std::filesystem::path >& p,
+                     genesis_init_function init,
+                     state_node_comparator_function comp,
+                     const unique_lock_ptr& lock )
+{
+  impl->open( p, init, comp, state_db_options(), lock ? lock : get_unique_lock() );
+}
+
+void database::open( const std::optional< std::filesystem::path >& p,
+                     genesis_init_function init,
+                     fork_resolution_algorithm algo,
+                     const state_db_options& options,
+                     const unique_lock_ptr& lock )
+{
+  impl->open( p, init, algo, options, lock ? lock : get_unique_lock() );
 }
 
 void database::open( const std::optional< std::filesystem::path >& p,
                      genesis_init_function init,
                      state_node_comparator_function comp,
+                     const state_db_options& options,
                      const unique_lock_ptr& lock )
 {
-  impl->open( p, init, comp, lock ? lock : get_unique_lock() );
+  impl->open( p, init, comp, options, lock ? lock : get_unique_lock() );
 }
 
 void database::close( const unique_lock_ptr& lock )
@@ -1393,6 +2092,18 @@ state_node_ptr database::get_node_at_revision( uint64_t revision, const unique_l
   return impl->get_node_at_revision( revision, null_id, lock );
 }
 
+state_node_ptr
+database::get_common_ancestor( const state_node_id& a, const state_node_id& b, const shared_lock_ptr& lock ) const
+{
+  return impl->get_common_ancestor( a, b, lock );
+}
+
+state_node_ptr
+database::get_common_ancestor( const state_node_id& a, const state_node_id& b, const unique_lock_ptr& lock ) const
+{
+  return impl->get_common_ancestor( a, b, lock );
+}
+
 state_node_ptr database::get_node( const state_node_id& node_id, const shared_lock_ptr& lock ) const
 {
   return impl->get_node( node_id, lock );
@@ -1462,6 +2173,11 @@ void database::commit_node( const state_node_id& node_id, const unique_lock_ptr&
   impl->commit_node( node_id, lock ? lock : get_unique_lock() );
 }
 
+std::shared_future< void > database::commit_node_async( const state_node_id& node_id, const unique_lock_ptr& lock )
+{
+  return impl->commit_node_async( node_id, lock ? lock : get_unique_lock() );
+}
+
 state_node_ptr database::get_head( const shared_lock_ptr& lock ) const
 {
   return impl->get_head( lock );
@@ -1,18 +1,188 @@
+#include <koinos/state_db/key_codec.hpp>
 #include <koinos/state_db/state_delta.hpp>
 
 #include <koinos/crypto/merkle_tree.hpp>
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <thread>
+
 namespace koinos::state_db::detail {
 
+namespace constants {
+// Merkle trees with fewer leaves than this are reduced on the calling thread
+constexpr std::size_t min_parallel_merkle_leaves = 1 << 14;
+} // namespace constants
+
 using backend_type = state_delta::backend_type;
 using value_type   = state_delta::value_type;
 
-state_delta::state_delta( const std::optional< std::filesystem::path >& p )
+/**
+ * Worker threads shared by every merkle root computation. The threads are started on first use
+ * and run for the life of the process.
+ */
+class merkle_pool final
+{
+public:
+  static merkle_pool& instance()
+  {
+    static merkle_pool pool;
+    return pool;
+  }
+
+  std::size_t workers() const
+  {
+    return _threads.size();
+  }
+
+  std::future< void > submit( std::packaged_task< void() > task )
+  {
+    auto result = task.get_future();
+
+    {
+      std::lock_guard< std::mutex > lock( _mutex );
+      _tasks.push_back( std::move( task ) );
+    }
+
+    _cv.notify_one();
+    return result;
+  }
+
+private:
+  merkle_pool()
+  {
+    const std::size_t threads = std::max( std::thread::hardware_concurrency(), 2u ) - 1;
+
+    for( std::size_t i = 0; i < threads; ++i )
+      _threads.emplace_back( [ this ]() { run(); } );
+  }
+
+  ~merkle_pool()
+  {
+    {
+      std::lock_guard< std::mutex > lock( _mutex );
+      _stopped = true;
+    }
+
+    _cv.notify_all();
+
+    for( auto& thread: _threads )
+      thread.join();
+  }
+
+  void run()
+  {
+    for( ;; )
+    {
+      std::packaged_task< void() > task;
+
+      {
+        std::unique_lock< std::mutex > lock( _mutex );
+        _cv.wait( lock,
+                  [ this ]()
+                  {
+                    return _stopped || !_tasks.empty();
+                  } );
+
+        if( _tasks.empty() )
+          return;
+
+        task = std::move( _tasks.front() );
+        _tasks.pop_front();
+      }
+
+      task();
+    }
+  }
+
+  std::mutex _mutex;
+  std::condition_variable _cv;
+  std::deque< std::packaged_task< void() > > _tasks;
+  std::vector< std::thread > _threads;
+  bool _stopped = false;
+};
+
+static crypto::multihash merkle_tree_root( const std::vector< crypto::multihash >& leaves )
+{
+  return crypto::merkle_tree( crypto::multicodec::sha2_256, leaves ).root()->hash();
+}
+
+// Reduces each block of leaves to its root on the pool, then reduces the roots of the blocks
+static crypto::multihash blocked_merkle_root( const std::vector< crypto::multihash >& leaves, std::size_t block_size )
+{
+  const std::size_t blocks = ( leaves.size() + block_size - 1 ) / block_size;
+  std::vector< crypto::multihash > roots( blocks );
+  std::vector< std::future< void > > reductions;
+  reductions.reserve( blocks - 1 );
+
+  auto reduce = [ & ]( std::size_t b )
+  {
+    auto first = leaves.begin() + b * block_size;
+    auto last  = leaves.begin() + std::min( ( b + 1 ) * block_size, leaves.size() );
+    roots[ b ] = merkle_tree_root( std::vector< crypto::multihash >( first, last ) );
+  };
+
+  for( std::size_t b = 1; b < blocks; ++b )
+    reductions.push_back( merkle_pool::instance().submit( std::packaged_task< void() >( std::bind( reduce, b ) ) ) );
+
+  reduce( 0 );
+
+  for( auto& reduction: reductions )
+    reduction.get();
+
+  return merkle_tree_root( roots );
+}
+
+/**
+ * Merkle roots are consensus critical, so the tree is always built by crypto::merkle_tree.
+ *
+ * When a tree pairs the nodes of each level from the left and carries an odd last node up
+ * unchanged, a block of 2^k leaves reduces to the node the whole tree has at level k, and the
+ * rest of the tree is the tree over the blocks' roots. That is checked once against the
+ * library before any tree is reduced in blocks.
+ */
+static bool merkle_blocks_match()
+{
+  static const bool match = []()
+  {
+    std::vector< crypto::multihash > leaves;
+    for( uint64_t i = 0; i < 7; ++i )
+      leaves.push_back( crypto::hash( crypto::multicodec::sha2_256, i ) );
+
+    const auto root = merkle_tree_root( leaves );
+
+    return blocked_merkle_root( leaves, 2 ) == root && blocked_merkle_root( leaves, 4 ) == root;
+  }();
+
+  return match;
+}
+
+static crypto::multihash parallel_merkle_root( const std::vector< crypto::multihash >& leaves )
+{
+  const auto workers = merkle_pool::instance().workers();
+
+  if( leaves.size() < constants::min_parallel_merkle_leaves || !workers || !merkle_blocks_match() )
+    return merkle_tree_root( leaves );
+
+  // Blocks are the smallest power of two that gives every worker and the caller one block
+  std::size_t block_size = 1;
+  while( block_size * ( workers + 1 ) < leaves.size() )
+    block_size <<= 1;
+
+  return blocked_merkle_root( leaves, block_size );
+}
+
+state_delta::state_delta( const std::optional< std::filesystem::path >& p, const state_db_options& options )
 {
   if( p )
   {
-    auto backend = std::make_shared< backends::rocksdb::rocksdb_backend >();
-    backend->open( *p );
+    auto backend = std::make_shared< backends::rocksdb::rocksdb_backend >( options.object_cache_size,
+                                                                            options.object_cache_shards,
+                                                                            options.object_cache_policy );
+    backend->open( *p, options );
     _backend = backend;
   }
   else
@@ -20,34 +190,134 @@ state_delta::state_delta( const std::optional< std::filesystem::path >& p )
     _backend = std::make_shared< backends::map::map_backend >();
   }
 
-  _revision    = _backend->revision();
-  _id          = _backend->id();
-  _merkle_root = _backend->merkle_root();
+  _root_backend = _backend;
+  _revision     = _backend->revision();
+  _id           = _backend->id();
+  _merkle_root  = _backend->merkle_root();
 }
 
 void state_delta::put( const key_type& k, const value_type& v )
 {
+  put( k, v, bool( find( k ) ) );
+}
+
+void state_delta::put( const key_type& k, const value_type& v, bool exists )
+{
+  // The first write of a key records whether it is new, so committing it does not read the root.
+  // Until this delta writes the key, it exists here exactly when it exists in the parent.
+  if( !is_root() && !exists && !is_written( k ) )
+    _new_objects.insert( k );
+
   _backend->put( k, v );
+  update_merkle_leaf( k, &v );
 }
 
 void state_delta::erase( const key_type& k )
 {
-  if( find( k ) )
+  erase( k, bool( find( k ) ) );
+}
+
+void state_delta::erase( const key_type& k, bool exists )
+{
+  if( exists )
   {
     _backend->erase( k );
     _removed_objects.insert( k );
+    update_merkle_leaf( k, nullptr );
   }
 }
 
-const value_type* state_delta::find( const key_type& key ) const
+void state_delta::update_merkle_leaf( const key_type& k, const value_type* v )
+{
+  // The root's merkle root is stored with its backend
+  if( is_root() )
+    return;
+
+  static const auto empty_hash = crypto::hash( crypto::multicodec::sha2_256, std::string() );
+
+  auto [ itr, inserted ] = _merkle_leaves.try_emplace( k );
+
+  if( inserted )
+    itr->second.key_hash = crypto::hash( crypto::multicodec::sha2_256, k );
+
+  // The written value is hashed where it is, an overwrite replaces the hash of the old value
+  itr->second.value_hash = v ? crypto::hash( crypto::multicodec::sha2_256, *v ) : empty_hash;
+  itr->second.exists     = v != nullptr;
+
+  _merkle_root.reset();
+}
+
+backends::value_handle state_delta::find( const key_type& key ) const
+{
+  if( is_root() )
+    return _backend->get( key );
+
+  if( backends::value_handle value; find_above_root( key, value ) )
+    return value;
+
+  return _root_backend->get( key );
+}
+
+std::vector< backends::value_handle > state_delta::find_many( const std::vector< key_type >& keys ) const
+{
+  if( is_root() )
+    return _backend->get_many( keys );
+
+  std::vector< backends::value_handle > values( keys.size() );
+  std::vector< key_type > root_keys;
+  std::vector< std::size_t > root_positions;
+
+  for( std::size_t i = 0; i < keys.size(); ++i )
+  {
+    if( !find_above_root( keys[ i ], values[ i ] ) )
+    {
+      root_keys.push_back( keys[ i ] );
+      root_positions.push_back( i );
+    }
+  }
+
+  if( root_keys.empty() )
+    return values;
+
+  // Everything not resolved by the deltas is read from the root backend in a single batch
+  auto root_values = _root_backend->get_many( root_keys );
+
+  for( std::size_t j = 0; j < root_positions.size(); ++j )
+    values[ root_positions[ j ] ] = root_values[ j ];
+
+  return values;
+}
+
+bool state_delta::find_above_root( const key_type& key, backends::value_handle& value ) const
 {
+  if( is_root() )
+    return false;
+
+  if( _finalized.load( std::memory_order_acquire ) )
+  {
+    // Entries at or below the root revision have since been committed to the root backend
+    if( auto entry = _index.find( key ); entry && entry->revision > _root_backend->revision() )
+    {
+      value = entry->value;
+      return true;
+    }
+
+    return false;
+  }
+
   if( auto val_ptr = _backend->get( key ); val_ptr )
-    return val_ptr;
+  {
+    value = val_ptr;
+    return true;
+  }
 
   if( is_removed( key ) )
-    return nullptr;
+  {
+    value = nullptr;
+    return true;
+  }
 
-  return is_root() ? nullptr : _parent->find( key );
+  return _parent->find_above_root( key, value );
 }
 
 void state_delta::squash()
@@ -61,7 +331,10 @@ void state_delta::squash()
   // nodes, whose modifications are much smaller
   for( const key_type& r_key: _removed_objects )
   {
-    _parent->_backend->erase( r_key );
+    if( !_parent->is_root() && is_new( r_key ) && !_parent->is_written( r_key ) )
+      _parent->_new_objects.insert( r_key );
+
+    _parent->_backend->erase( r_key, !is_new( r_key ) );
 
     if( !_parent->is_root() )
     {
@@ -71,86 +344,245 @@ void state_delta::squash()
 
   for( auto itr = _backend->begin(); itr != _backend->end(); ++itr )
   {
-    _parent->_backend->put( itr.key(), *itr );
+    if( !_parent->is_root() && is_new( itr.key() ) && !_parent->is_written( itr.key() ) )
+      _parent->_new_objects.insert( itr.key() );
+
+    _parent->_backend->put( itr.key(), *itr, !is_new( itr.key() ) && !is_removed( itr.key() ) );
 
     if( !_parent->is_root() )
     {
       _parent->_removed_objects.erase( itr.key() );
     }
   }
+
+  // Our leaves hash the final value of each key we modified, which is now the parent's value
+  if( !_parent->is_root() )
+  {
+    for( const auto& [ key, leaf ]: _merkle_leaves )
+      _parent->_merkle_leaves[ key ] = leaf;
+
+    _parent->_merkle_root.reset();
+  }
 }
 
 void state_delta::commit()
 {
   /**
-   * commit works in two distinct phases. The first is head recursion until we are at the root
-   * delta. At the root, we grab the backend and begin a write batch that will encompass all
-   * state writes and the final write of the metadata.
-   *
-   * The second phase is popping off the stack, writing state to the backend. After all deltas
-   * have been written to the backend, we write metadata to the backend and end the write batch.
+   * commit works in two distinct phases. The first, write_commit, writes the net changes of the
+   * deltas between the root and this delta to the root backend in one write batch. The second,
+   * finish_commit, makes this delta the new root delta.
    *
    * The result is this delta becomes the new root delta and state is written to the root backend
    * atomically.
    */
+  write_commit();
+  finish_commit();
+}
+
+void state_delta::write_commit()
+{
+  /**
+   * The deltas above the root are collected and their net effect is written, one operation per
+   * key, inside a write batch that also holds the metadata of this delta. Neither the deltas nor
+   * the root backend's in memory metadata are modified. A RocksDB batch is only visible once it
+   * is written, so readers may keep reading through the deltas while it is written. A map backend
+   * has no batches and is written in place, so it must not be read while it is written.
+   */
   KOINOS_ASSERT( !is_root(), internal_error, "cannot commit root" );
 
   std::vector< std::shared_ptr< state_delta > > node_stack;
   auto current_node = shared_from_this();
 
-  while( current_node )
+  while( !current_node->is_root() )
   {
     node_stack.push_back( current_node );
     current_node = current_node->_parent;
   }
 
-  // Because we already asserted we were not root, there will always exist a minimum of two nodes in the stack,
-  // this and root.
-  auto backend = node_stack.back()->_backend;
-  node_stack.back()->_backend.reset();
-  node_stack.pop_back();
+  auto backend = current_node->_backend;
 
   // Start the write batch
   backend->start_write_batch();
 
-  // While there are nodes on the stack, write them to the backend
-  while( node_stack.size() )
+  try
   {
-    auto& node = node_stack.back();
-
-    for( const key_type& r_key: node->_removed_objects )
-    {
-      backend->erase( r_key );
-    }
+    // Write the net changes of the deltas on the stack, oldest first
+    std::reverse( node_stack.begin(), node_stack.end() );
+    write_changes( *backend, node_stack );
 
-    for( auto itr = node->_backend->begin(); itr != node->_backend->end(); ++itr )
-    {
-      backend->put( itr.key(), *itr );
-    }
+    // Write metadata describing this delta
+    backend->store_metadata( _revision, _id, merkle_root(), block_header() );
 
-    node_stack.pop_back();
+    // End the write batch making the entire merge atomic
+    backend->end_write_batch();
   }
+  catch( ... )
+  {
+    // The deltas are untouched, so the same commit can be written again
+    backend->abort_write_batch();
+    throw;
+  }
+}
+
+void state_delta::finish_commit()
+{
+  KOINOS_ASSERT( !is_root(), internal_error, "cannot commit root" );
+
+  // The old root hands its backend to this delta
+  auto root    = get_root();
+  auto backend = root->_backend;
+  root->_backend.reset();
 
   // Update metadata on the backend
   backend->set_block_header( block_header() );
   backend->set_revision( _revision );
   backend->set_id( _id );
   backend->set_merkle_root( merkle_root() );
-  backend->store_metadata();
-
-  // End the write batch making the entire merge atomic
-  backend->end_write_batch();
 
   // Reset local variables to match new status as root delta
   _removed_objects.clear();
-  _backend = backend;
+  _new_objects.clear();
+  _index       = delta_index();
+  _index_floor = 0;
+  _backend     = backend;
   _parent.reset();
+  _jump.reset();
+}
+
+void state_delta::write_changes( backend_type& backend, const std::vector< std::shared_ptr< state_delta > >& deltas )
+{
+  /**
+   * Each delta's modifications form a sorted stream of puts and removals. The streams are merged
+   * in key order with a heap, newer deltas winning ties, so every key is written once with the
+   * value of the newest delta that modified it. The oldest delta that modified a key knows
+   * whether it existed in the backend.
+   */
+  struct stream
+  {
+    backends::iterator itr;
+    backends::iterator end;
+    std::vector< const key_type* > removed;
+    std::size_t removed_pos = 0;
+    const key_type* key     = nullptr;
+    bool is_removal         = false;
+
+    void update()
+    {
+      const bool has_put     = itr != end;
+      const bool has_removal = removed_pos < removed.size();
+
+      if( has_put && ( !has_removal || itr.key() <= *removed[ removed_pos ] ) )
+      {
+        key        = &itr.key();
+        is_removal = false;
+      }
+      else if( has_removal )
+      {
+        key        = removed[ removed_pos ];
+        is_removal = true;
+      }
+      else
+      {
+        key = nullptr;
+      }
+    }
+
+    void advance()
+    {
+      // A key both removed and written again by the same delta is a put
+      if( removed_pos < removed.size() && *removed[ removed_pos ] == *key )
+        removed_pos++;
+
+      if( !is_removal )
+        ++itr;
+
+      update();
+    }
+  };
+
+  std::vector< stream > streams;
+  streams.reserve( deltas.size() );
+
+  for( const auto& delta: deltas )
+  {
+    auto& s = streams.emplace_back( stream{ delta->_backend->begin(), delta->_backend->end() } );
+
+    s.removed.reserve( delta->_removed_objects.size() );
+    for( const auto& r_key: delta->_removed_objects )
+      s.removed.push_back( &r_key );
+
+    std::sort( s.removed.begin(),
+               s.removed.end(),
+               []( const key_type* a, const key_type* b )
+               {
+                 return *a < *b;
+               } );
+
+    s.update();
+  }
+
+  // The top of the heap holds the smallest key, from the newest delta
+  auto lower_priority = [ & ]( std::size_t a, std::size_t b )
+  {
+    if( *streams[ a ].key != *streams[ b ].key )
+      return *streams[ a ].key > *streams[ b ].key;
+
+    return a < b;
+  };
+
+  std::vector< std::size_t > heap;
+  heap.reserve( streams.size() );
+
+  for( std::size_t i = 0; i < streams.size(); ++i )
+  {
+    if( streams[ i ].key )
+      heap.push_back( i );
+  }
+
+  std::make_heap( heap.begin(), heap.end(), lower_priority );
+
+  std::vector< std::size_t > matching;
+
+  while( !heap.empty() )
+  {
+    matching.clear();
+
+    do
+    {
+      std::pop_heap( heap.begin(), heap.end(), lower_priority );
+      matching.push_back( heap.back() );
+      heap.pop_back();
+    }
+    while( !heap.empty() && *streams[ heap.front() ].key == *streams[ matching.front() ].key );
+
+    const auto& newest = streams[ matching.front() ];
+    const auto& key    = *newest.key;
+    const bool exists  = !deltas[ matching.back() ]->is_new( key );
+
+    if( !newest.is_removal )
+      backend.put( key, *newest.itr, exists );
+    else if( exists )
+      backend.erase( key, exists );
+
+    for( auto i: matching )
+    {
+      streams[ i ].advance();
+
+      if( streams[ i ].key )
+      {
+        heap.push_back( i );
+        std::push_heap( heap.begin(), heap.end(), lower_priority );
+      }
+    }
+  }
 }
 
 void state_delta::clear()
 {
   _backend->clear();
   _removed_objects.clear();
+  _new_objects.clear();
+  _merkle_leaves.clear();
 
   _revision = 0;
   _id       = crypto::multihash::zero( crypto::multicodec::sha2_256 );
@@ -161,11 +593,36 @@ bool state_delta::is_modified( const key_type& k ) const
   return _backend->get( k ) || _removed_objects.find( k ) != _removed_objects.end();
 }
 
+bool state_delta::is_modified_since( const key_type& k, uint64_t revision ) const
+{
+  if( _revision <= revision || is_root() )
+    return false;
+
+  // A finalized delta's index holds the newest revision of every key modified above the root
+  if( _finalized.load( std::memory_order_acquire ) )
+  {
+    auto entry = _index.find( k );
+    return entry && entry->revision > revision;
+  }
+
+  return is_modified( k ) || _parent->is_modified_since( k, revision );
+}
+
 bool state_delta::is_removed( const key_type& k ) const
 {
   return _removed_objects.find( k ) != _removed_objects.end();
 }
 
+bool state_delta::is_written( const key_type& k ) const
+{
+  return _backend->get( k ) || is_removed( k );
+}
+
+bool state_delta::is_new( const key_type& k ) const
+{
+  return _new_objects.find( k ) != _new_objects.end();
+}
+
 bool state_delta::is_root() const
 {
   return !_parent;
@@ -187,12 +644,80 @@ void state_delta::set_revision( uint64_t revision )
 
 bool state_delta::is_finalized() const
 {
-  return _finalized;
+  return _finalized.load( std::memory_order_acquire );
 }
 
 void state_delta::finalize()
 {
-  _finalized = true;
+  if( !is_root() )
+  {
+    build_index();
+
+    // The leaves are already hashed, so the root is ready before anyone asks for it
+    merkle_root();
+    _merkle_leaves.clear();
+  }
+
+  _finalized.store( true, std::memory_order_release );
+}
+
+void state_delta::build_index()
+{
+  /**
+   * The index of a finalized delta contains the newest modification of every key written
+   * between the root and this delta, so find never has to walk the parent chain.
+   *
+   * It is normally the parent's index plus our own modifications. Entries from deltas that
+   * have since been committed are redundant with the root backend, so once they outnumber
+   * the live entries we rebuild from the deltas above the root instead. This keeps the index
+   * proportional to the reversible window at an amortized cost of one insert per write.
+   */
+  std::vector< const state_delta* > chain{ this };
+  delta_index base;
+  _index_floor = _revision;
+
+  if( !_parent->is_root() )
+  {
+    const auto root_revision = _root_backend->revision();
+    const auto stale         = root_revision >= _parent->_index_floor ? root_revision - _parent->_index_floor + 1 : 0;
+
+    if( stale <= _revision - root_revision )
+    {
+      base         = _parent->_index;
+      _index_floor = _parent->_index_floor;
+    }
+    else
+    {
+      for( auto delta = _parent.get(); !delta->is_root(); delta = delta->_parent.get() )
+      {
+        chain.push_back( delta );
+        _index_floor = delta->_revision;
+      }
+    }
+  }
+
+  delta_index::builder builder( base );
+
+  for( auto itr = chain.rbegin(); itr != chain.rend(); ++itr )
+  {
+    ( *itr )->index_modifications( builder );
+  }
+
+  _index = builder.finish();
+}
+
+void state_delta::index_modifications( delta_index::builder& builder ) const
+{
+  // Removals are applied first because a key can be removed and then written again in the same delta
+  for( const key_type& r_key: _removed_objects )
+  {
+    builder.put( r_key, { _revision, nullptr } );
+  }
+
+  for( auto itr = _backend->begin(); itr != _backend->end(); ++itr )
+  {
+    builder.put( itr.key(), { _revision, &*itr } );
+  }
 }
 
 std::condition_variable_any& state_delta::cv()
@@ -209,31 +734,23 @@ crypto::multihash state_delta::merkle_root() const
 {
   if( !_merkle_root )
   {
-    std::vector< std::string > object_keys;
-    object_keys.reserve( _backend->size() + _removed_objects.size() );
-    for( auto itr = _backend->begin(); itr != _backend->end(); ++itr )
-    {
-      object_keys.push_back( itr.key() );
-    }
-
-    for( const auto& removed: _removed_objects )
-    {
-      object_keys.push_back( removed );
-    }
-
-    std::sort( object_keys.begin(), object_keys.end() );
-
     std::vector< crypto::multihash > merkle_leafs;
-    merkle_leafs.reserve( object_keys.size() * 2 );
+    merkle_leafs.reserve( ( _merkle_leaves.size() + _removed_objects.size() ) * 2 );
 
-    for( const auto& key: object_keys )
+    for( const auto& [ key, leaf ]: _merkle_leaves )
     {
-      merkle_leafs.emplace_back( crypto::hash( crypto::multicodec::sha2_256, key ) );
-      auto val_ptr = _backend->get( key );
-      merkle_leafs.emplace_back( crypto::hash( crypto::multicodec::sha2_256, val_ptr ? *val_ptr : std::string() ) );
+      // A key removed and then written again is a leaf of both the removed and the written keys
+      const auto copies = ( leaf.exists ? 1 : 0 ) + ( is_removed( key ) ? 1 : 0 );
+
+      for( int i = 0; i < copies; ++i )
+      {
+        merkle_leafs.push_back( leaf.key_hash );
+        merkle_leafs.push_back( leaf.value_hash );
+      }
     }
 
-    _merkle_root = crypto::merkle_tree( crypto::multicodec::sha2_256, merkle_leafs ).root()->hash();
+    // The leaves are hashed as objects are written, a large tree has its levels reduced in parallel
+    _merkle_root = parallel_merkle_root( merkle_leafs );
   }
 
   return *_merkle_root;
@@ -246,13 +763,23 @@ const protocol::block_header& state_delta::block_header() const
 
 std::shared_ptr< state_delta > state_delta::make_child( const state_node_id& id, const protocol::block_header& header )
 {
-  auto child       = std::make_shared< state_delta >();
-  child->_parent   = shared_from_this();
-  child->_id       = id;
-  child->_revision = _revision + 1;
-  child->_backend  = std::make_shared< backends::map::map_backend >();
+  auto child           = std::make_shared< state_delta >();
+  child->_parent       = shared_from_this();
+  child->_jump         = shared_from_this();
+  child->_id           = id;
+  child->_revision     = _revision + 1;
+  child->_backend      = std::make_shared< backends::map::map_backend >();
+  child->_root_backend = _root_backend;
   child->_backend->set_block_header( header );
 
+  // When the parent's jump and its jump's jump are the same length, the child jumps over both
+  if( auto jump = _jump.lock(); jump )
+  {
+    if( auto next_jump = jump->_jump.lock();
+        next_jump && _revision - jump->_revision == jump->_revision - next_jump->_revision )
+      child->_jump = next_jump;
+  }
+
   return child;
 }
 
@@ -260,14 +787,18 @@ std::shared_ptr< state_delta > state_delta::clone( const state_node_id& id, cons
 {
   auto new_node              = std::make_shared< state_delta >();
   new_node->_parent          = _parent;
+  new_node->_jump            = _jump;
   new_node->_backend         = _backend->clone();
+  new_node->_root_backend    = _root_backend;
   new_node->_removed_objects = _removed_objects;
+  new_node->_new_objects     = _new_objects;
+  new_node->_merkle_leaves   = _merkle_leaves;
 
   new_node->_id          = id;
   new_node->_revision    = _revision;
   new_node->_merkle_root = _merkle_root;
 
-  new_node->_finalized = _finalized;
+  new_node->_finalized.store( is_finalized(), std::memory_order_release );
 
   new_node->_backend->set_id( id );
   new_node->_backend->set_revision( _revision );
@@ -302,6 +833,56 @@ std::shared_ptr< state_delta > state_delta::parent() const
   return _parent;
 }
 
+std::shared_ptr< state_delta > state_delta::ancestor( uint64_t revision )
+{
+  if( revision > _revision )
+    return std::shared_ptr< state_delta >();
+
+  auto delta = shared_from_this();
+
+  while( delta && delta->_revision > revision )
+  {
+    if( auto jump = delta->_jump.lock(); jump && jump->_revision >= revision )
+      delta = jump;
+    else
+      delta = delta->_parent;
+  }
+
+  return delta;
+}
+
+std::shared_ptr< state_delta > state_delta::common_ancestor( std::shared_ptr< state_delta > a,
+                                                             std::shared_ptr< state_delta > b )
+{
+  if( !a || !b )
+    return std::shared_ptr< state_delta >();
+
+  const auto revision = std::min( a->_revision, b->_revision );
+  a                   = a->ancestor( revision );
+  b                   = b->ancestor( revision );
+
+  // Deltas at the same revision have jumps of the same length. Jumping while the jumps differ and
+  // stepping to the parent otherwise meets at the common ancestor in O(log n) steps.
+  while( a && b && a != b )
+  {
+    auto a_jump = a->_jump.lock();
+    auto b_jump = b->_jump.lock();
+
+    if( a_jump && b_jump && a_jump != b_jump && a_jump->_revision == b_jump->_revision )
+    {
+      a = a_jump;
+      b = b_jump;
+    }
+    else
+    {
+      a = a->_parent;
+      b = b->_parent;
+    }
+  }
+
+  return a == b ? a : std::shared_ptr< state_delta >();
+}
+
 bool state_delta::is_empty() const
 {
   if( _backend->size() )
@@ -348,20 +929,20 @@ std::vector< protocol::state_delta_entry > state_delta::get_delta_entries() cons
   {
     protocol::state_delta_entry entry;
 
-    // Deserialize the key into a database_key object
-    koinos::chain::database_key db_key;
-    if( db_key.ParseFromString( key ) )
+    object_space space;
+    object_key obj_key;
+    if( key_codec::decode( key, space, obj_key ) )
     {
-      entry.mutable_object_space()->set_system( db_key.space().system() );
-      entry.mutable_object_space()->set_zone( db_key.space().zone() );
-      entry.mutable_object_space()->set_id( db_key.space().id() );
+      entry.mutable_object_space()->set_system( space.system() );
+      entry.mutable_object_space()->set_zone( space.zone() );
+      entry.mutable_object_space()->set_id( space.id() );
 
-      entry.set_key( db_key.key() );
+      entry.set_key( obj_key );
       auto value = _backend->get( key );
 
       // Set the optional field if not null
       if( value != nullptr )
-        entry.set_value( *value );
+        entry.set_value( std::string( *value ) );
 
       deltas.push_back( entry );
     }
@@ -2,14 +2,18 @@
 #include <koinos/state_db/backends/backend.hpp>
 #include <koinos/state_db/backends/map/map_backend.hpp>
 #include <koinos/state_db/backends/rocksdb/rocksdb_backend.hpp>
+#include <koinos/state_db/delta_index.hpp>
+#include <koinos/state_db/state_db_options.hpp>
 #include <koinos/state_db/state_db_types.hpp>
 
 #include <koinos/crypto/multihash.hpp>
 #include <koinos/protocol/protocol.pb.h>
 
 #include <any>
+#include <atomic>
 #include <condition_variable>
 #include <filesystem>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <unordered_set>
@@ -26,33 +30,63 @@ public:
 private:
   std::shared_ptr< state_delta > _parent;
 
+  // An ancestor further up the chain. Jumps are laid out as a skew binary list, so any ancestor is
+  // reached in O(log n) steps. Ancestors below the root are released, so the jump may expire.
+  std::weak_ptr< state_delta > _jump;
+
   std::shared_ptr< backend_type > _backend;
+  std::shared_ptr< backend_type > _root_backend;
   std::unordered_set< key_type > _removed_objects;
+  std::unordered_set< key_type > _new_objects; // Written keys that did not exist in the parent's state
+
+  delta_index _index;
+  uint64_t _index_floor = 0;
 
   state_node_id _id;
   uint64_t _revision = 0;
   mutable std::optional< crypto::multihash > _merkle_root;
 
-  bool _finalized = false;
+  struct merkle_leaf
+  {
+    crypto::multihash key_hash;
+    crypto::multihash value_hash;
+    bool exists = false;
+  };
+
+  // Hashes of every modified key and its value, kept as objects are written so the merkle root
+  // only has to build the tree
+  std::map< key_type, merkle_leaf > _merkle_leaves;
+
+  // Readers holding only a shared lock check this before reading _index, so it is set with release
+  // semantics once finalize has built the index
+  std::atomic< bool > _finalized = false;
 
   std::timed_mutex _cv_mutex;
   std::condition_variable_any _cv;
 
 public:
   state_delta() = default;
-  state_delta( const std::optional< std::filesystem::path >& p );
+  state_delta( const std::optional< std::filesystem::path >& p, const state_db_options& options = state_db_options() );
   ~state_delta() = default;
 
   void put( const key_type& k, const value_type& v );
   void erase( const key_type& k );
-  const value_type* find( const key_type& key ) const;
+
+  // Callers that have just read the key pass whether it exists in this delta's state
+  void put( const key_type& k, const value_type& v, bool exists );
+  void erase( const key_type& k, bool exists );
+  backends::value_handle find( const key_type& key ) const;
+  std::vector< backends::value_handle > find_many( const std::vector< key_type >& keys ) const;
 
   void squash();
   void commit();
+  void write_commit();
+  void finish_commit();
 
   void clear();
 
   bool is_modified( const key_type& k ) const;
+  bool is_modified_since( const key_type& k, uint64_t revision ) const;
   bool is_removed( const key_type& k ) const;
   bool is_root() const;
   bool is_empty() const;
@@ -72,6 +106,9 @@ public:
   const state_node_id& id() const;
   const state_node_id& parent_id() const;
   std::shared_ptr< state_delta > parent() const;
+  std::shared_ptr< state_delta > ancestor( uint64_t revision );
+  static std::shared_ptr< state_delta > common_ancestor( std::shared_ptr< state_delta > a,
+                                                         std::shared_ptr< state_delta > b );
   const protocol::block_header& block_header() const;
 
   std::shared_ptr< state_delta > make_child( const state_node_id& id              = state_node_id(),
@@ -82,6 +119,13 @@ public:
 
 private:
   void commit_helper();
+  static void write_changes( backend_type& backend, const std::vector< std::shared_ptr< state_delta > >& deltas );
+  bool find_above_root( const key_type& key, backends::value_handle& value ) const;
+  bool is_written( const key_type& k ) const;
+  bool is_new( const key_type& k ) const;
+  void build_index();
+  void index_modifications( delta_index::builder& builder ) const;
+  void update_merkle_leaf( const key_type& k, const value_type* v );
 
   std::shared_ptr< state_delta > get_root();
 };
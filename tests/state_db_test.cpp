@@ -7,15 +7,19 @@
 #include <koinos/log.hpp>
 #include <koinos/state_db/backends/map/map_backend.hpp>
 #include <koinos/state_db/backends/rocksdb/rocksdb_backend.hpp>
+#include <koinos/state_db/key_codec.hpp>
 #include <koinos/state_db/merge_iterator.hpp>
 #include <koinos/state_db/state_db.hpp>
 #include <koinos/state_db/state_delta.hpp>
 #include <koinos/util/conversion.hpp>
 #include <koinos/util/random.hpp>
 
+#include <atomic>
 #include <deque>
 #include <filesystem>
 #include <iostream>
+#include <random>
+#include <thread>
 
 using namespace koinos;
 using namespace koinos::state_db;
@@ -90,7 +94,7 @@ BOOST_AUTO_TEST_CASE( basic_test )
     BOOST_CHECK_EQUAL( state_1->put_object( space, a_key, &a_val ), a_val.size() + key_size );
 
     // Object should not exist on older state node
-    BOOST_CHECK_EQUAL( db.get_root( shared_db_lock )->get_object( space, a_key ), nullptr );
+    BOOST_CHECK( !db.get_root( shared_db_lock )->get_object( space, a_key ) );
 
     auto ptr = state_1->get_object( space, a_key );
     BOOST_REQUIRE( ptr );
@@ -1023,7 +1027,7 @@ BOOST_AUTO_TEST_CASE( rocksdb_object_cache_test )
   try
   {
     std::size_t cache_size = 1'024;
-    koinos::state_db::backends::rocksdb::object_cache cache( cache_size );
+    koinos::state_db::backends::rocksdb::object_cache cache( cache_size, 1 );
     using value_type = koinos::state_db::backends::rocksdb::object_cache::value_type;
 
     std::string a_key = "a";
@@ -2408,4 +2412,1777 @@ BOOST_AUTO_TEST_CASE( prev_object_exception )
   KOINOS_CATCH_LOG_AND_RETHROW( info )
 }
 
+BOOST_AUTO_TEST_CASE( deep_chain_lookup )
+{
+  try
+  {
+    BOOST_TEST_MESSAGE( "Checking point lookups across a deep chain of deltas" );
+    constexpr uint64_t num_keys = 37;
+    object_space space;
+
+    auto shared_db_lock = db.get_shared_lock();
+
+    std::vector< crypto::multihash > ids{ db.get_root( shared_db_lock )->id() };
+    std::vector< std::map< std::string, std::string > > expected( 1 );
+
+    auto verify = [ & ]( abstract_state_node_ptr node, const std::map< std::string, std::string >& state )
+    {
+      for( uint64_t k = 0; k <= num_keys; ++k )
+      {
+        auto key = k == num_keys ? "hot"s : "key" + std::to_string( k );
+        auto ptr = node->get_object( space, key );
+
+        if( auto itr = state.find( key ); itr != state.end() )
+        {
+          BOOST_REQUIRE( ptr );
+          BOOST_CHECK_EQUAL( *ptr, itr->second );
+        }
+        else
+        {
+          BOOST_CHECK( !ptr );
+        }
+      }
+
+      // Scanning must skip every object shadowed by a newer delta
+      std::map< std::string, std::string > scanned;
+      for( auto cursor = node->scan( space, "" ); cursor.valid(); cursor.next() )
+        scanned[ cursor.key() ] = cursor.value();
+
+      BOOST_CHECK( scanned == state );
+    };
+
+    for( uint64_t i = 1; i <= 400; ++i )
+    {
+      if( i == 200 || i == 300 )
+      {
+        BOOST_TEST_MESSAGE( "Committing revision " << i - 100 );
+        shared_db_lock.reset();
+        db.commit_node( ids[ i - 100 ], db.get_unique_lock() );
+        shared_db_lock = db.get_shared_lock();
+      }
+
+      auto id   = crypto::hash( crypto::multicodec::sha2_256, i );
+      auto node = db.create_writable_node( ids.back(), id, protocol::block_header(), shared_db_lock );
+      BOOST_REQUIRE( node );
+
+      auto state = expected.back();
+      auto key   = "key" + std::to_string( i % num_keys );
+      auto val   = "val" + std::to_string( i );
+
+      if( i % 7 == 0 )
+      {
+        node->remove_object( space, key );
+        state.erase( key );
+      }
+      else
+      {
+        node->put_object( space, key, &val );
+        state[ key ] = val;
+      }
+
+      if( i % 50 == 0 )
+      {
+        node->remove_object( space, "hot" );
+        state.erase( "hot" );
+      }
+      else
+      {
+        node->put_object( space, "hot", &val );
+        state[ "hot" ] = val;
+      }
+
+      db.finalize_node( id, shared_db_lock );
+      verify( node, state );
+
+      ids.push_back( id );
+      expected.push_back( state );
+    }
+
+    BOOST_TEST_MESSAGE( "Checking every node above the root" );
+    verify( db.get_root( shared_db_lock ), expected[ 200 ] );
+
+    for( uint64_t i = 201; i <= 400; ++i )
+    {
+      auto node = db.get_node( ids[ i ], shared_db_lock );
+      BOOST_REQUIRE( node );
+      verify( node, expected[ i ] );
+    }
+
+    BOOST_TEST_MESSAGE( "Checking a fork and an anonymous node on top of the chain" );
+    auto fork_id = crypto::hash( crypto::multicodec::sha2_256, 1'000 );
+    auto fork    = db.create_writable_node( ids[ 390 ], fork_id, protocol::block_header(), shared_db_lock );
+    BOOST_REQUIRE( fork );
+
+    auto state           = expected[ 390 ];
+    std::string fork_val = "fork";
+    fork->put_object( space, "key0", &fork_val );
+    state[ "key0" ] = fork_val;
+    fork->remove_object( space, "hot" );
+    state.erase( "hot" );
+    db.finalize_node( fork_id, shared_db_lock );
+
+    verify( fork, state );
+    verify( db.get_node( ids[ 391 ], shared_db_lock ), expected[ 391 ] );
+
+    auto anon_state = state;
+    auto anon       = fork->create_anonymous_node();
+    anon->put_object( space, "hot", &fork_val );
+    anon_state[ "hot" ] = fork_val;
+    anon->remove_object( space, "key1" );
+    anon_state.erase( "key1" );
+
+    verify( anon, anon_state );
+    verify( fork, state );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( key_codec_test )
+{
+  try
+  {
+    BOOST_TEST_MESSAGE( "Checking encoded keys match the serialized database key" );
+    std::vector< object_space > spaces( 4 );
+    spaces[ 1 ].set_system( true );
+    spaces[ 2 ].set_zone( "zone" );
+    spaces[ 2 ].set_id( 3 );
+    spaces[ 3 ].set_system( true );
+    spaces[ 3 ].set_zone( std::string( 200, 'z' ) );
+    spaces[ 3 ].set_id( 1'000'000 );
+
+    std::vector< object_key > keys = { "",
+                                       "a",
+                                       std::string( 127, 'k' ),
+                                       std::string( 128, 'k' ),
+                                       std::string( 300, 'k' ) };
+
+    for( const auto& space: spaces )
+    {
+      state_db::detail::key_codec codec( space );
+
+      for( const auto& key: keys )
+      {
+        chain::database_key db_key;
+        *db_key.mutable_space() = space;
+        db_key.set_key( key );
+
+        auto encoded = codec.encode( key );
+        BOOST_REQUIRE( encoded == util::converter::as< std::string >( db_key ) );
+
+        BOOST_TEST_MESSAGE( "Checking encoded keys decode to their space and key" );
+        object_key decoded_key;
+        BOOST_REQUIRE( codec.decode( encoded, decoded_key ) );
+        BOOST_REQUIRE( decoded_key == key );
+
+        object_space decoded_space;
+        BOOST_REQUIRE( state_db::detail::key_codec::decode( encoded, decoded_space, decoded_key ) );
+        BOOST_REQUIRE( decoded_space.system() == space.system() );
+        BOOST_REQUIRE( decoded_space.zone() == space.zone() );
+        BOOST_REQUIRE( decoded_space.id() == space.id() );
+        BOOST_REQUIRE( decoded_key == key );
+
+        for( const auto& other: spaces )
+        {
+          if( &other != &space )
+            BOOST_REQUIRE( !state_db::detail::key_codec( other ).decode( encoded, decoded_key ) );
+        }
+      }
+    }
+
+    BOOST_TEST_MESSAGE( "Checking malformed keys are rejected" );
+    object_space space;
+    object_key key;
+    BOOST_CHECK( !state_db::detail::key_codec::decode( "", space, key ) );
+    BOOST_CHECK( !state_db::detail::key_codec::decode( "\x0a\x05", space, key ) );
+    BOOST_CHECK( !state_db::detail::key_codec::decode( std::string( "\x0a\x00\x12\x05", 4 ), space, key ) );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( get_objects_test )
+{
+  try
+  {
+    BOOST_TEST_MESSAGE( "Creating objects in the database" );
+    object_space space;
+    auto shared_db_lock = db.get_shared_lock();
+
+    auto state_1 = db.create_writable_node( db.get_head( shared_db_lock )->id(),
+                                            crypto::hash( crypto::multicodec::sha2_256, 1 ),
+                                            protocol::block_header(),
+                                            shared_db_lock );
+    BOOST_REQUIRE( state_1 );
+
+    for( uint64_t i = 0; i < 10; ++i )
+    {
+      std::string val = "value" + std::to_string( i );
+      state_1->put_object( space, "key" + std::to_string( i ), &val );
+    }
+
+    db.finalize_node( state_1->id(), shared_db_lock );
+    auto state_1_id = state_1->id();
+    state_1.reset();
+    shared_db_lock.reset();
+    db.commit_node( state_1_id, db.get_unique_lock() );
+
+    shared_db_lock = db.get_shared_lock();
+    auto head      = db.get_head( shared_db_lock );
+
+    BOOST_TEST_MESSAGE( "Modifying objects in pending state nodes" );
+    auto state_2 = db.create_writable_node( state_1_id,
+                                            crypto::hash( crypto::multicodec::sha2_256, 2 ),
+                                            protocol::block_header(),
+                                            shared_db_lock );
+    BOOST_REQUIRE( state_2 );
+
+    std::string val = "modified";
+    state_2->put_object( space, "key1", &val );
+    state_2->remove_object( space, "key2" );
+    db.finalize_node( state_2->id(), shared_db_lock );
+
+    auto state_3 = db.create_writable_node( state_2->id(),
+                                            crypto::hash( crypto::multicodec::sha2_256, 3 ),
+                                            protocol::block_header(),
+                                            shared_db_lock );
+    BOOST_REQUIRE( state_3 );
+
+    state_3->put_object( space, "key3", &val );
+    state_3->remove_object( space, "key4" );
+    state_3->put_object( space, "new", &val );
+
+    BOOST_TEST_MESSAGE( "Checking batched reads match single reads" );
+    std::vector< object_space_key > keys;
+    for( uint64_t i = 0; i < 10; ++i )
+      keys.emplace_back( space, "key" + std::to_string( i ) );
+
+    keys.emplace_back( space, "new" );
+    keys.emplace_back( space, "missing" );
+    keys.emplace_back( space, "key0" );
+
+    for( const auto& node: { state_3, state_2, head } )
+    {
+      auto values = node->get_objects( keys );
+      BOOST_REQUIRE_EQUAL( values.size(), keys.size() );
+
+      for( std::size_t i = 0; i < keys.size(); ++i )
+      {
+        auto expected = node->get_object( keys[ i ].first, keys[ i ].second );
+        BOOST_REQUIRE_EQUAL( bool( values[ i ] ), bool( expected ) );
+
+        if( expected )
+          BOOST_REQUIRE_EQUAL( *values[ i ], *expected );
+      }
+    }
+
+    auto values = state_3->get_objects( keys );
+    BOOST_CHECK_EQUAL( *values[ 0 ], "value0" );
+    BOOST_CHECK_EQUAL( *values[ 1 ], "modified" );
+    BOOST_CHECK( !values[ 2 ] );
+    BOOST_CHECK_EQUAL( *values[ 3 ], "modified" );
+    BOOST_CHECK( !values[ 4 ] );
+    BOOST_CHECK_EQUAL( *values[ 10 ], "modified" );
+    BOOST_CHECK( !values[ 11 ] );
+    BOOST_CHECK_EQUAL( *values[ 12 ], "value0" );
+
+    BOOST_CHECK( state_3->get_objects( {} ).empty() );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( scan_test )
+{
+  try
+  {
+    BOOST_TEST_MESSAGE( "Creating objects across committed and pending state" );
+    object_space space, before_space, after_space;
+    space.set_id( 2 );
+    before_space.set_id( 1 );
+    after_space.set_id( 3 );
+
+    auto shared_db_lock = db.get_shared_lock();
+
+    auto state_1 = db.create_writable_node( db.get_head( shared_db_lock )->id(),
+                                            crypto::hash( crypto::multicodec::sha2_256, 1 ),
+                                            protocol::block_header(),
+                                            shared_db_lock );
+    BOOST_REQUIRE( state_1 );
+
+    std::string val = "value";
+    state_1->put_object( before_space, "b", &val );
+    state_1->put_object( after_space, "b", &val );
+
+    for( char c = 'a'; c < 'k'; c += 2 )
+      state_1->put_object( space, std::string( 1, c ), &val );
+
+    db.finalize_node( state_1->id(), shared_db_lock );
+    auto state_1_id = state_1->id();
+    state_1.reset();
+    shared_db_lock.reset();
+    db.commit_node( state_1_id, db.get_unique_lock() );
+    shared_db_lock = db.get_shared_lock();
+
+    auto state_2 = db.create_writable_node( state_1_id,
+                                            crypto::hash( crypto::multicodec::sha2_256, 2 ),
+                                            protocol::block_header(),
+                                            shared_db_lock );
+    BOOST_REQUIRE( state_2 );
+
+    for( char c = 'b'; c < 'k'; c += 4 )
+      state_2->put_object( space, std::string( 1, c ), &val );
+
+    state_2->remove_object( space, "c" );
+    db.finalize_node( state_2->id(), shared_db_lock );
+
+    auto state_3 = db.create_writable_node( state_2->id(),
+                                            crypto::hash( crypto::multicodec::sha2_256, 3 ),
+                                            protocol::block_header(),
+                                            shared_db_lock );
+    BOOST_REQUIRE( state_3 );
+
+    std::string new_val = "new value";
+    state_3->put_object( space, "e", &new_val );
+    state_3->put_object( space, "h", &new_val );
+    state_3->remove_object( space, "f" );
+
+    BOOST_TEST_MESSAGE( "Checking a forward scan matches get_next_object" );
+    std::vector< std::string > forward;
+    for( auto cursor = state_3->scan( space, "" ); cursor.valid(); cursor.next() )
+    {
+      BOOST_REQUIRE( state_3->get_object( space, cursor.key() ) );
+      BOOST_CHECK_EQUAL( cursor.value(), *state_3->get_object( space, cursor.key() ) );
+      forward.push_back( cursor.key() );
+    }
+
+    std::vector< std::string > expected;
+    object_key next_key;
+    while( true )
+    {
+      auto [ next_val, key ] = state_3->get_next_object( space, next_key );
+      if( !next_val )
+        break;
+
+      next_key = key;
+      expected.push_back( next_key );
+    }
+
+    BOOST_CHECK( forward == expected );
+    BOOST_CHECK( forward == std::vector< std::string >( { "a", "b", "e", "g", "h", "i", "j" } ) );
+
+    BOOST_TEST_MESSAGE( "Checking a reverse scan visits the same objects backwards" );
+    std::vector< std::string > reverse;
+    for( auto cursor = state_3->scan( space, "", "", scan_direction::reverse ); cursor.valid(); cursor.next() )
+      reverse.push_back( cursor.key() );
+
+    std::reverse( reverse.begin(), reverse.end() );
+    BOOST_CHECK( reverse == forward );
+
+    BOOST_TEST_MESSAGE( "Checking scans respect the range bounds" );
+    std::vector< std::string > bounded;
+    for( auto cursor = state_3->scan( space, "b", "h" ); cursor.valid(); cursor.next() )
+      bounded.push_back( cursor.key() );
+
+    BOOST_CHECK( bounded == std::vector< std::string >( { "b", "e", "g" } ) );
+
+    bounded.clear();
+    for( auto cursor = state_3->scan( space, "c", "i", scan_direction::reverse ); cursor.valid(); cursor.next() )
+      bounded.push_back( cursor.key() );
+
+    BOOST_CHECK( bounded == std::vector< std::string >( { "h", "g", "e" } ) );
+
+    BOOST_CHECK( !state_3->scan( space, "k" ).valid() );
+    BOOST_CHECK( !state_3->scan( space, "a", "a" ).valid() );
+    BOOST_CHECK( !state_3->scan( object_space(), "" ).valid() );
+
+    auto cursor = state_3->scan( space, "j" );
+    BOOST_REQUIRE( cursor.valid() );
+    cursor.next();
+    BOOST_CHECK( !cursor.valid() );
+    BOOST_CHECK_THROW( cursor.next(), illegal_argument );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( sharded_object_cache_test )
+{
+  try
+  {
+    using koinos::state_db::backends::rocksdb::object_cache;
+    using value_type = object_cache::value_type;
+
+    BOOST_TEST_MESSAGE( "Checking objects are found across shards" );
+    object_cache cache( 1'024, 4 );
+
+    for( uint64_t i = 0; i < 20; ++i )
+      cache.put( "key" + std::to_string( i ), std::make_shared< const value_type >( "val" + std::to_string( i ) ) );
+
+    for( uint64_t i = 0; i < 20; ++i )
+    {
+      auto [ cache_hit, val_ptr ] = cache.get( "key" + std::to_string( i ) );
+      BOOST_CHECK( cache_hit );
+      BOOST_REQUIRE( val_ptr );
+      BOOST_CHECK_EQUAL( *val_ptr, "val" + std::to_string( i ) );
+    }
+
+    BOOST_TEST_MESSAGE( "Checking each shard evicts its least recently used objects" );
+    cache.put( "hot", std::make_shared< const value_type >( "hot" ) );
+
+    for( uint64_t i = 0; i < 1'000; ++i )
+    {
+      cache.put( "fill" + std::to_string( i ), std::make_shared< const value_type >( 10, 'f' ) );
+      BOOST_REQUIRE( cache.get( "hot" ).first );
+    }
+
+    uint64_t cached = 0;
+    for( uint64_t i = 0; i < 1'000; ++i )
+    {
+      if( cache.get( "fill" + std::to_string( i ) ).first )
+        cached++;
+    }
+
+    // Every object uses at least 15 bytes of the 1 KB capacity
+    BOOST_CHECK_GT( cached, 0 );
+    BOOST_CHECK_LE( cached * 15, 1'024 );
+    BOOST_CHECK( cache.get( "fill999" ).first );
+
+    cache.clear();
+    BOOST_CHECK( !cache.get( "hot" ).first );
+    BOOST_CHECK( !cache.get( "fill999" ).first );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( object_cache_scan_resistance_test )
+{
+  try
+  {
+    using koinos::state_db::backends::rocksdb::cache_policy;
+    using koinos::state_db::backends::rocksdb::object_cache;
+    using value_type = object_cache::value_type;
+
+    const std::size_t cache_size = 64 << 10;
+    const uint64_t hot_keys      = 200;
+    const std::string value( 100, 'v' );
+
+    // Point reads of a hot set that fits in the cache, interleaved with scans of objects that are never read again
+    auto hit_ratio = [ & ]( cache_policy policy )
+    {
+      object_cache cache( cache_size, 4, policy );
+      uint64_t hits = 0, reads = 0, scanned = 0;
+
+      auto read = [ & ]( const std::string& key )
+      {
+        if( cache.get( key ).first )
+          return true;
+
+        cache.put( key, std::make_shared< const value_type >( value ) );
+        return false;
+      };
+
+      for( uint64_t round = 0; round < 50; ++round )
+      {
+        for( uint64_t i = 0; i < 2'000; ++i )
+        {
+          if( read( "hot" + std::to_string( ( i * 7 ) % hot_keys ) ) && round > 0 )
+            hits++;
+
+          if( round > 0 )
+            reads++;
+        }
+
+        for( uint64_t i = 0; i < 1'000; ++i )
+          read( "scan" + std::to_string( scanned++ ) );
+      }
+
+      return double( hits ) / double( reads );
+    };
+
+    auto lru_ratio     = hit_ratio( cache_policy::lru );
+    auto tinylfu_ratio = hit_ratio( cache_policy::tinylfu );
+
+    BOOST_TEST_MESSAGE( "LRU hit ratio: " << lru_ratio );
+    BOOST_TEST_MESSAGE( "TinyLFU hit ratio: " << tinylfu_ratio );
+
+    BOOST_CHECK_GT( tinylfu_ratio, 0.99 );
+    BOOST_CHECK_GT( tinylfu_ratio, lru_ratio );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( value_handle_test )
+{
+  try
+  {
+    BOOST_TEST_MESSAGE( "Checking value handles outlive cache eviction" );
+    koinos::state_db::backends::rocksdb::rocksdb_backend backend( 1'024, 1 );
+    auto temp = std::filesystem::temp_directory_path() / util::random_alphanumeric( 8 );
+    std::filesystem::create_directory( temp );
+    backend.open( temp );
+
+    const std::string value( 256, 'a' );
+    backend.put( "a", value );
+
+    auto handle = backend.get( "a" );
+    BOOST_REQUIRE( handle );
+
+    auto cursor = backend.begin();
+    BOOST_REQUIRE( cursor != backend.end() );
+    auto cursor_handle = cursor.handle();
+
+    // Each put fills most of the cache, evicting everything read before it
+    for( uint64_t i = 0; i < 16; ++i )
+      backend.put( "fill" + std::to_string( i ), std::string( 512, 'f' ) );
+
+    BOOST_CHECK_EQUAL( *handle, value );
+    BOOST_CHECK_EQUAL( handle.size(), value.size() );
+    BOOST_CHECK_EQUAL( *cursor_handle, value );
+    BOOST_CHECK_EQUAL( *backend.get( "a" ), value );
+
+    BOOST_CHECK( !backend.get( "b" ) );
+    BOOST_CHECK( backend.get( "b" ) == nullptr );
+
+    backend.close();
+    std::filesystem::remove_all( temp );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( commit_size_test )
+{
+  try
+  {
+    std::filesystem::path temp = std::filesystem::temp_directory_path() / koinos::util::random_alphanumeric( 8 );
+    std::filesystem::create_directory( temp );
+
+    auto root = std::make_shared< state_delta >( temp );
+    root->put( "alice", "1" );
+    root->put( "bob", "2" );
+    BOOST_CHECK_EQUAL( root->backend()->size(), 2 );
+
+    BOOST_TEST_MESSAGE( "Checking size after committing new, modified, and removed objects" );
+    auto delta_1 = root->make_child( crypto::hash( crypto::multicodec::sha2_256, 1 ) );
+    delta_1->put( "alice", "3" );
+    delta_1->put( "charlie", "4" );
+    delta_1->erase( "bob" );
+    delta_1->put( "dave", "5" );
+    delta_1->erase( "dave" );
+    delta_1->erase( "eve" );
+
+    auto delta_2 = delta_1->make_child( crypto::hash( crypto::multicodec::sha2_256, 2 ) );
+    delta_2->put( "bob", "6" );
+    delta_2->put( "dave", "7" );
+    delta_2->erase( "charlie" );
+    delta_2->put( "charlie", "8" );
+
+    BOOST_TEST_MESSAGE( "Checking size after squashing into an uncommitted parent" );
+    auto anon = delta_2->make_child();
+    anon->put( "eve", "9" );
+    anon->put( "frank", "10" );
+    anon->erase( "frank" );
+    anon->erase( "alice" );
+    anon->squash();
+
+    delta_2->commit();
+
+    // bob, charlie, dave, eve
+    BOOST_CHECK_EQUAL( delta_2->backend()->size(), 4 );
+
+    std::size_t count = 0;
+    for( auto itr = delta_2->backend()->begin(); itr != delta_2->backend()->end(); ++itr )
+      count++;
+
+    BOOST_CHECK_EQUAL( count, 4 );
+
+    BOOST_TEST_MESSAGE( "Checking size after squashing into the root" );
+    auto anon_root = delta_2->make_child();
+    anon_root->put( "bob", "11" );
+    anon_root->put( "grace", "12" );
+    anon_root->erase( "dave" );
+    anon_root->squash();
+
+    // bob, charlie, eve, grace
+    BOOST_CHECK_EQUAL( delta_2->backend()->size(), 4 );
+
+    delta_2.reset();
+    delta_1.reset();
+    root.reset();
+    anon.reset();
+    anon_root.reset();
+    std::filesystem::remove_all( temp );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( rocksdb_write_batch_test )
+{
+  try
+  {
+    auto temp = std::filesystem::temp_directory_path() / util::random_alphanumeric( 8 );
+    std::filesystem::create_directory( temp );
+
+    auto id = crypto::hash( crypto::multicodec::sha2_256, 1 );
+
+    {
+      koinos::state_db::backends::rocksdb::rocksdb_backend backend;
+      backend.open( temp );
+      backend.put( "alice", "1" );
+      backend.put( "bob", "2" );
+      backend.set_revision( 1 );
+      backend.set_id( id );
+      backend.store_metadata();
+      backend.close();
+    }
+
+    BOOST_TEST_MESSAGE( "Checking an abandoned write batch leaves objects and metadata untouched" );
+    {
+      koinos::state_db::backends::rocksdb::rocksdb_backend backend;
+      backend.open( temp );
+      backend.start_write_batch();
+      backend.put( "charlie", "3" );
+      backend.erase( "alice" );
+      backend.set_revision( 2 );
+      backend.set_id( crypto::hash( crypto::multicodec::sha2_256, 2 ) );
+      backend.store_metadata();
+      backend.close();
+    }
+
+    {
+      koinos::state_db::backends::rocksdb::rocksdb_backend backend;
+      backend.open( temp );
+      BOOST_CHECK_EQUAL( backend.revision(), 1 );
+      BOOST_CHECK( backend.id() == id );
+      BOOST_CHECK_EQUAL( backend.size(), 2 );
+      BOOST_CHECK( backend.get( "alice" ) );
+      BOOST_CHECK( !backend.get( "charlie" ) );
+
+      BOOST_TEST_MESSAGE( "Checking a finished write batch stores objects and metadata together" );
+      backend.start_write_batch();
+      backend.put( "charlie", "3" );
+      backend.erase( "alice" );
+      backend.set_revision( 2 );
+      backend.store_metadata();
+      backend.end_write_batch();
+      backend.close();
+    }
+
+    {
+      koinos::state_db::backends::rocksdb::rocksdb_backend backend;
+      backend.open( temp );
+      BOOST_CHECK_EQUAL( backend.revision(), 2 );
+      BOOST_CHECK_EQUAL( backend.size(), 2 );
+      BOOST_CHECK( !backend.get( "alice" ) );
+      BOOST_REQUIRE( backend.get( "charlie" ) );
+      BOOST_CHECK_EQUAL( *backend.get( "charlie" ), "3" );
+      backend.close();
+    }
+
+    std::filesystem::remove_all( temp );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( commit_net_changes_test )
+{
+  try
+  {
+    std::filesystem::path temp = std::filesystem::temp_directory_path() / koinos::util::random_alphanumeric( 8 );
+    std::filesystem::create_directory( temp );
+
+    auto root = std::make_shared< state_delta >( temp );
+    root->put( "balance", "0" );
+    root->put( "removed", "0" );
+    root->put( "restored", "0" );
+
+    std::map< std::string, std::string > expected;
+    expected[ "balance" ]  = "0";
+    expected[ "removed" ]  = "0";
+    expected[ "restored" ] = "0";
+
+    auto delta = root;
+    for( uint64_t i = 1; i <= 10; ++i )
+    {
+      delta = delta->make_child( crypto::hash( crypto::multicodec::sha2_256, i ) );
+
+      // A key written by every delta
+      delta->put( "balance", std::to_string( i ) );
+      expected[ "balance" ] = std::to_string( i );
+
+      // Keys created and removed within the chain
+      delta->put( "temp" + std::to_string( i ), "t" );
+      if( i > 1 )
+        delta->erase( "temp" + std::to_string( i - 1 ) );
+
+      // Keys removed and written again in later deltas
+      if( i == 3 )
+        delta->erase( "restored" );
+      if( i == 7 )
+        delta->put( "restored", "7" );
+      if( i == 5 )
+        delta->erase( "removed" );
+    }
+
+    expected[ "temp10" ]   = "t";
+    expected[ "restored" ] = "7";
+    expected.erase( "removed" );
+
+    delta->commit();
+
+    BOOST_CHECK_EQUAL( delta->backend()->size(), expected.size() );
+
+    auto expected_itr = expected.begin();
+    for( auto itr = delta->backend()->begin(); itr != delta->backend()->end(); ++itr, ++expected_itr )
+    {
+      BOOST_REQUIRE( expected_itr != expected.end() );
+      BOOST_CHECK_EQUAL( itr.key(), expected_itr->first );
+      BOOST_CHECK_EQUAL( *itr, expected_itr->second );
+    }
+
+    BOOST_CHECK( expected_itr == expected.end() );
+
+    delta.reset();
+    root.reset();
+    std::filesystem::remove_all( temp );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( commit_node_async_test )
+{
+  try
+  {
+    object_space space;
+    std::string a_key = "a";
+    std::string b_key = "b";
+    std::string c_key = "c";
+    std::string val_1 = "1";
+    std::string val_2 = "2";
+    std::string val_3 = "3";
+    std::string val_4 = "4";
+
+    auto shared_db_lock = db.get_shared_lock();
+
+    auto state_1_id = crypto::hash( crypto::multicodec::sha2_256, 1 );
+    auto state_1    = db.create_writable_node( db.get_head( shared_db_lock )->id(),
+                                            state_1_id,
+                                            protocol::block_header(),
+                                            shared_db_lock );
+    state_1->put_object( space, a_key, &val_1 );
+    state_1->put_object( space, b_key, &val_2 );
+    db.finalize_node( state_1_id, shared_db_lock );
+
+    auto state_2_id = crypto::hash( crypto::multicodec::sha2_256, 2 );
+    auto state_2    = db.create_writable_node( state_1_id, state_2_id, protocol::block_header(), shared_db_lock );
+    state_2->put_object( space, a_key, &val_3 );
+    state_2->remove_object( space, b_key );
+    db.finalize_node( state_2_id, shared_db_lock );
+
+    auto state_3_id = crypto::hash( crypto::multicodec::sha2_256, 3 );
+    auto state_3    = db.create_writable_node( state_2_id, state_3_id, protocol::block_header(), shared_db_lock );
+    state_3->put_object( space, c_key, &val_4 );
+    db.finalize_node( state_3_id, shared_db_lock );
+
+    state_1.reset();
+    state_2.reset();
+    state_3.reset();
+    shared_db_lock.reset();
+
+    BOOST_TEST_MESSAGE( "Checking the committed node is the root before it is written" );
+    auto written = db.commit_node_async( state_2_id, db.get_unique_lock() );
+
+    shared_db_lock = db.get_shared_lock();
+    BOOST_CHECK( db.get_root( shared_db_lock )->id() == state_2_id );
+    BOOST_CHECK_EQUAL( db.get_root( shared_db_lock )->revision(), 2 );
+    BOOST_CHECK( !db.get_node( state_1_id, shared_db_lock ) );
+
+    state_3 = db.get_node( state_3_id, shared_db_lock );
+    BOOST_REQUIRE( state_3 );
+    BOOST_REQUIRE( state_3->get_object( space, a_key ) );
+    BOOST_CHECK_EQUAL( *state_3->get_object( space, a_key ), val_3 );
+    BOOST_CHECK( !state_3->get_object( space, b_key ) );
+    BOOST_REQUIRE( state_3->get_object( space, c_key ) );
+    BOOST_CHECK_EQUAL( *state_3->get_object( space, c_key ), val_4 );
+
+    BOOST_TEST_MESSAGE( "Checking reads after the write is finished" );
+    written.get();
+
+    BOOST_REQUIRE( state_3->get_object( space, a_key ) );
+    BOOST_CHECK_EQUAL( *state_3->get_object( space, a_key ), val_3 );
+    BOOST_CHECK( !state_3->get_object( space, b_key ) );
+
+    auto [ next, next_key ] = state_3->get_next_object( space, a_key );
+    BOOST_REQUIRE( next );
+    BOOST_CHECK_EQUAL( *next, val_4 );
+    BOOST_CHECK_EQUAL( next_key, c_key );
+
+    state_3.reset();
+    shared_db_lock.reset();
+
+    BOOST_TEST_MESSAGE( "Checking a pending commit is finished by the next commit" );
+    db.commit_node_async( state_3_id, db.get_unique_lock() );
+    db.close( db.get_unique_lock() );
+    db.open( temp, [ & ]( state_db::state_node_ptr root ) {}, &state_db::fifo_comparator, db.get_unique_lock() );
+
+    shared_db_lock = db.get_shared_lock();
+    auto root      = db.get_root( shared_db_lock );
+    BOOST_CHECK( root->id() == state_3_id );
+    BOOST_CHECK_EQUAL( root->revision(), 3 );
+    BOOST_REQUIRE( root->get_object( space, a_key ) );
+    BOOST_CHECK_EQUAL( *root->get_object( space, a_key ), val_3 );
+    BOOST_CHECK( !root->get_object( space, b_key ) );
+    BOOST_REQUIRE( root->get_object( space, c_key ) );
+    BOOST_CHECK_EQUAL( *root->get_object( space, c_key ), val_4 );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( rocksdb_ingest_test )
+{
+  try
+  {
+    auto temp = std::filesystem::temp_directory_path() / util::random_alphanumeric( 8 );
+    std::filesystem::create_directory( temp );
+
+    using koinos::state_db::backends::rocksdb::rocksdb_backend;
+
+    {
+      rocksdb_backend backend;
+      backend.open( temp );
+      backend.put( "alice", "1" );
+      backend.put( "bob", "2" );
+      backend.set_revision( 1 );
+      backend.store_metadata();
+      backend.close();
+    }
+
+    BOOST_TEST_MESSAGE( "Checking a write batch over the threshold is ingested" );
+    {
+      state_db_options options;
+      options.ingest_threshold = 1;
+
+      rocksdb_backend backend;
+      backend.open( temp, options );
+      backend.start_write_batch();
+      backend.put( "charlie", "3" );
+      backend.put( "alice", "4" );
+      backend.erase( "bob" );
+      backend.put( "charlie", "5" );
+      backend.set_revision( 2 );
+      backend.store_metadata();
+      backend.end_write_batch();
+
+      BOOST_CHECK( !std::filesystem::exists( temp / "ingest" ) );
+      BOOST_REQUIRE( backend.get( "charlie" ) );
+      BOOST_CHECK_EQUAL( *backend.get( "charlie" ), "5" );
+      backend.close();
+    }
+
+    {
+      rocksdb_backend backend;
+      backend.open( temp );
+      BOOST_CHECK_EQUAL( backend.revision(), 2 );
+      BOOST_CHECK_EQUAL( backend.size(), 2 );
+      BOOST_CHECK( !backend.get( "bob" ) );
+
+      std::vector< std::pair< std::string, std::string > > objects;
+      for( auto itr = backend.begin(); itr != backend.end(); ++itr )
+        objects.emplace_back( itr.key(), *itr );
+
+      BOOST_REQUIRE_EQUAL( objects.size(), 2 );
+      BOOST_CHECK_EQUAL( objects[ 0 ].first, "alice" );
+      BOOST_CHECK_EQUAL( objects[ 0 ].second, "4" );
+      BOOST_CHECK_EQUAL( objects[ 1 ].first, "charlie" );
+      BOOST_CHECK_EQUAL( objects[ 1 ].second, "5" );
+      backend.close();
+    }
+
+    std::filesystem::remove_all( temp );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( rocksdb_ingest_disabled_test )
+{
+  try
+  {
+    BOOST_TEST_MESSAGE( "Checking ingestion is disabled by default" );
+    BOOST_CHECK_EQUAL( state_db_options().ingest_threshold, 0 );
+
+    auto temp = std::filesystem::temp_directory_path() / util::random_alphanumeric( 8 );
+    std::filesystem::create_directory( temp );
+    auto moved = temp.string() + "-moved";
+
+    using koinos::state_db::backends::rocksdb::rocksdb_backend;
+
+    BOOST_TEST_MESSAGE( "Checking a zero threshold writes every batch through the write path" );
+    {
+      state_db_options options;
+      options.ingest_threshold = 0;
+
+      rocksdb_backend backend;
+      backend.open( temp, options );
+      backend.put( "alice", "1" );
+
+      // Building ingested files fails without the database directory, a plain batch write does not
+      backend.start_write_batch();
+      backend.put( "bob", "2" );
+      backend.erase( "alice" );
+      backend.set_revision( 1 );
+      backend.store_metadata();
+
+      std::filesystem::rename( temp, moved );
+      BOOST_CHECK_NO_THROW( backend.end_write_batch() );
+      std::filesystem::rename( moved, temp );
+
+      BOOST_TEST_MESSAGE( "Checking an empty batch is written" );
+      backend.start_write_batch();
+      std::filesystem::rename( temp, moved );
+      BOOST_CHECK_NO_THROW( backend.end_write_batch() );
+      std::filesystem::rename( moved, temp );
+
+      backend.close();
+    }
+
+    {
+      rocksdb_backend backend;
+      backend.open( temp );
+      BOOST_CHECK_EQUAL( backend.revision(), 1 );
+      BOOST_CHECK_EQUAL( backend.size(), 1 );
+      BOOST_CHECK( !backend.get( "alice" ) );
+      BOOST_REQUIRE( backend.get( "bob" ) );
+      BOOST_CHECK_EQUAL( *backend.get( "bob" ), "2" );
+      backend.close();
+    }
+
+    std::filesystem::remove_all( temp );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( failed_commit_test )
+{
+  try
+  {
+    // Moving the database directory away makes building the ingested files of a commit fail
+    state_db_options options;
+    options.ingest_threshold = 1;
+
+    auto moved = temp.string() + "-moved";
+
+    BOOST_TEST_MESSAGE( "Checking a failed write batch leaves the backend as it was" );
+    {
+      auto path = std::filesystem::temp_directory_path() / util::random_alphanumeric( 8 );
+      std::filesystem::create_directory( path );
+
+      koinos::state_db::backends::rocksdb::rocksdb_backend backend;
+      backend.open( path, options );
+      backend.put( "alice", "1" );
+
+      backend.start_write_batch();
+      backend.put( "bob", "2" );
+      backend.erase( "alice" );
+      backend.set_revision( 1 );
+      backend.store_metadata();
+
+      std::filesystem::rename( path, moved );
+      BOOST_CHECK_THROW( backend.end_write_batch(), std::exception );
+      std::filesystem::rename( moved, path );
+
+      BOOST_CHECK_EQUAL( backend.size(), 1 );
+      BOOST_CHECK( backend.get( "alice" ) );
+      BOOST_CHECK( !backend.get( "bob" ) );
+
+      backend.start_write_batch();
+      backend.put( "bob", "2" );
+      backend.store_metadata();
+      backend.end_write_batch();
+
+      BOOST_CHECK_EQUAL( backend.size(), 2 );
+      BOOST_REQUIRE( backend.get( "bob" ) );
+      BOOST_CHECK_EQUAL( *backend.get( "bob" ), "2" );
+      backend.close();
+
+      std::filesystem::remove_all( path );
+    }
+
+    db.close( db.get_unique_lock() );
+    db.open( temp,
+             [ & ]( state_db::state_node_ptr root ) {},
+             fork_resolution_algorithm::fifo,
+             options,
+             db.get_unique_lock() );
+
+    object_space space;
+    std::string a_key = "a";
+    std::string b_key = "b";
+    std::string val_1 = "1";
+    std::string val_2 = "2";
+
+    auto shared_db_lock = db.get_shared_lock();
+
+    auto state_1_id = crypto::hash( crypto::multicodec::sha2_256, 1 );
+    auto state_1    = db.create_writable_node( db.get_head( shared_db_lock )->id(),
+                                            state_1_id,
+                                            protocol::block_header(),
+                                            shared_db_lock );
+    state_1->put_object( space, a_key, &val_1 );
+    db.finalize_node( state_1_id, shared_db_lock );
+
+    auto state_2_id = crypto::hash( crypto::multicodec::sha2_256, 2 );
+    auto state_2    = db.create_writable_node( state_1_id, state_2_id, protocol::block_header(), shared_db_lock );
+    state_2->put_object( space, b_key, &val_2 );
+    db.finalize_node( state_2_id, shared_db_lock );
+
+    state_1.reset();
+    state_2.reset();
+    shared_db_lock.reset();
+
+    BOOST_TEST_MESSAGE( "Checking a failed asynchronous commit keeps the node readable" );
+    std::filesystem::rename( temp, moved );
+    auto written = db.commit_node_async( state_1_id, db.get_unique_lock() );
+    BOOST_CHECK_THROW( written.get(), std::exception );
+    std::filesystem::rename( moved, temp );
+
+    shared_db_lock = db.get_shared_lock();
+    BOOST_CHECK( db.get_root( shared_db_lock )->id() == state_1_id );
+    BOOST_REQUIRE( db.get_root( shared_db_lock )->get_object( space, a_key ) );
+    BOOST_CHECK_EQUAL( *db.get_root( shared_db_lock )->get_object( space, a_key ), val_1 );
+    shared_db_lock.reset();
+
+    BOOST_TEST_MESSAGE( "Checking the root is written again by committing it" );
+    db.commit_node( state_1_id, db.get_unique_lock() );
+
+    BOOST_TEST_MESSAGE( "Checking a failed synchronous commit leaves the node in place" );
+    std::filesystem::rename( temp, moved );
+    BOOST_CHECK_THROW( db.commit_node( state_2_id, db.get_unique_lock() ), std::exception );
+    std::filesystem::rename( moved, temp );
+
+    shared_db_lock = db.get_shared_lock();
+    BOOST_CHECK( db.get_root( shared_db_lock )->id() == state_1_id );
+    BOOST_CHECK( db.get_head( shared_db_lock )->id() == state_2_id );
+    BOOST_REQUIRE( db.get_node( state_2_id, shared_db_lock ) );
+    BOOST_REQUIRE( db.get_node( state_2_id, shared_db_lock )->get_object( space, b_key ) );
+    BOOST_CHECK_EQUAL( db.get_all_nodes( shared_db_lock ).size(), 2 );
+    shared_db_lock.reset();
+
+    BOOST_TEST_MESSAGE( "Checking a later commit is written" );
+    db.commit_node_async( state_2_id, db.get_unique_lock() ).get();
+    db.close( db.get_unique_lock() );
+    db.open( temp, [ & ]( state_db::state_node_ptr root ) {}, fork_resolution_algorithm::fifo, db.get_unique_lock() );
+
+    shared_db_lock = db.get_shared_lock();
+    auto root      = db.get_root( shared_db_lock );
+    BOOST_CHECK( root->id() == state_2_id );
+    BOOST_CHECK_EQUAL( root->revision(), 2 );
+    BOOST_REQUIRE( root->get_object( space, a_key ) );
+    BOOST_CHECK_EQUAL( *root->get_object( space, a_key ), val_1 );
+    BOOST_REQUIRE( root->get_object( space, b_key ) );
+    BOOST_CHECK_EQUAL( *root->get_object( space, b_key ), val_2 );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( in_memory_commit_node_async_test )
+{
+  try
+  {
+    db.close( db.get_unique_lock() );
+    db.open( {}, [ & ]( state_db::state_node_ptr root ) {}, fork_resolution_algorithm::fifo, db.get_unique_lock() );
+
+    object_space space;
+    auto shared_db_lock = db.get_shared_lock();
+    auto parent_id      = db.get_root( shared_db_lock )->id();
+
+    for( uint64_t i = 1; i <= 20; ++i )
+    {
+      auto node_id = crypto::hash( crypto::multicodec::sha2_256, i );
+      auto node    = db.create_writable_node( parent_id, node_id, protocol::block_header(), shared_db_lock );
+      BOOST_REQUIRE( node );
+
+      for( uint64_t k = 0; k < 100; ++k )
+      {
+        auto value = std::to_string( i );
+        node->put_object( space, std::to_string( k ), &value );
+      }
+
+      db.finalize_node( node_id, shared_db_lock );
+      parent_id = node_id;
+    }
+
+    shared_db_lock.reset();
+
+    BOOST_TEST_MESSAGE( "Reading an in memory database while its commits are written" );
+
+    // Boost.Test assertions are not thread safe, readers count what they saw instead
+    std::atomic< bool > done          = false;
+    std::atomic< uint64_t > bad_reads = 0;
+    std::vector< std::thread > readers;
+
+    for( int r = 0; r < 4; ++r )
+    {
+      readers.emplace_back(
+        [ & ]()
+        {
+          while( !done )
+          {
+            {
+              auto reader_lock    = db.get_shared_lock();
+              auto head           = db.get_head( reader_lock );
+              auto value          = head->get_object( space, "0" );
+              std::size_t scanned = 0;
+
+              for( auto cursor = head->scan( space, "" ); cursor.valid(); cursor.next() )
+                ++scanned;
+
+              if( !value || *value != "20" || scanned != 100 )
+                ++bad_reads;
+            }
+
+            // The lock is released with the node and cursor, leaving the writer gaps to take it in
+            std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+          }
+        } );
+    }
+
+    for( uint64_t i = 1; i <= 20; ++i )
+    {
+      auto written = db.commit_node_async( crypto::hash( crypto::multicodec::sha2_256, i ), db.get_unique_lock() );
+      BOOST_CHECK( written.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready );
+      written.get();
+    }
+
+    done = true;
+    for( auto& reader: readers )
+      reader.join();
+
+    BOOST_CHECK_EQUAL( bad_reads, 0 );
+
+    shared_db_lock = db.get_shared_lock();
+    auto root      = db.get_root( shared_db_lock );
+    BOOST_CHECK( root->id() == parent_id );
+    BOOST_REQUIRE( root->get_object( space, "99" ) );
+    BOOST_CHECK_EQUAL( *root->get_object( space, "99" ), "20" );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( state_db_options_test )
+{
+  try
+  {
+    state_db_options options;
+    options.object_cache_size      = 1 << 20;
+    options.object_cache_shards    = 4;
+    options.object_cache_policy    = koinos::state_db::backends::rocksdb::cache_policy::lru;
+    options.block_cache_size       = 8 << 20;
+    options.bloom_bits_per_key     = 10;
+    options.partition_filters      = true;
+    options.compression_per_level  = { compression_type::none, compression_type::lz4, compression_type::zstd };
+    options.bottommost_compression = compression_type::zstd;
+    options.write_buffer_size      = 4 << 20;
+    options.sync_writes            = true;
+    options.max_background_jobs    = 4;
+
+    BOOST_TEST_MESSAGE( "Opening the database with options" );
+    db.close( db.get_unique_lock() );
+    db.open( temp,
+             []( state_db::state_node_ptr root ) {},
+             fork_resolution_algorithm::fifo,
+             options,
+             db.get_unique_lock() );
+
+    object_space space;
+    std::string a_key = "a";
+    std::string a_val = "alice";
+
+    auto shared_db_lock = db.get_shared_lock();
+    auto state_id       = crypto::hash( crypto::multicodec::sha2_256, 1 );
+    auto state_1        = db.create_writable_node( db.get_head( shared_db_lock )->id(),
+                                            state_id,
+                                            protocol::block_header(),
+                                            shared_db_lock );
+    state_1->put_object( space, a_key, &a_val );
+    db.finalize_node( state_id, shared_db_lock );
+    state_1.reset();
+    shared_db_lock.reset();
+
+    db.commit_node( state_id, db.get_unique_lock() );
+
+    BOOST_TEST_MESSAGE( "Checking committed state after reopening with options" );
+    db.close( db.get_unique_lock() );
+    db.open( temp,
+             []( state_db::state_node_ptr root ) {},
+             fork_resolution_algorithm::fifo,
+             options,
+             db.get_unique_lock() );
+
+    shared_db_lock = db.get_shared_lock();
+    auto root      = db.get_root( shared_db_lock );
+    BOOST_CHECK( root->id() == state_id );
+    BOOST_REQUIRE( root->get_object( space, a_key ) );
+    BOOST_CHECK_EQUAL( *root->get_object( space, a_key ), a_val );
+    root.reset();
+    shared_db_lock.reset();
+
+    BOOST_TEST_MESSAGE( "Checking the database reopens with its options when reset" );
+    db.reset( db.get_unique_lock() );
+
+    shared_db_lock = db.get_shared_lock();
+    BOOST_CHECK_EQUAL( db.get_root( shared_db_lock )->revision(), 0 );
+    BOOST_CHECK( !db.get_root( shared_db_lock )->get_object( space, a_key ) );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( rocksdb_prefix_seek_test )
+{
+  try
+  {
+    auto temp = std::filesystem::temp_directory_path() / util::random_alphanumeric( 8 );
+    std::filesystem::create_directory( temp );
+
+    using koinos::state_db::backends::rocksdb::rocksdb_backend;
+
+    object_space space_1, space_2, space_3, empty_space;
+    space_1.set_id( 1 );
+    space_2.set_id( 2 );
+    space_3.set_id( 3 );
+    empty_space.set_id( 4 );
+
+    detail::key_codec codec_1( space_1 ), codec_2( space_2 ), codec_3( space_3 ), empty_codec( empty_space );
+
+    state_db_options options;
+    options.bloom_bits_per_key  = 10;
+    options.object_space_prefix = true;
+
+    rocksdb_backend backend;
+    backend.open( temp, options );
+
+    for( const auto& key: { "a", "c", "e" } )
+    {
+      backend.put( codec_1.encode( key ), key );
+      backend.put( codec_2.encode( key ), key );
+      backend.put( codec_3.encode( key ), key );
+    }
+
+    BOOST_TEST_MESSAGE( "Checking a seek scans its object space" );
+    std::vector< std::string > keys;
+    for( auto itr = backend.lower_bound( codec_2.encode( "b" ) ); itr != backend.end(); ++itr )
+    {
+      object_key key;
+      if( !codec_2.decode( itr.key(), key ) )
+        break;
+
+      keys.push_back( key );
+    }
+
+    BOOST_CHECK( keys == std::vector< std::string >( { "c", "e" } ) );
+
+    BOOST_TEST_MESSAGE( "Checking stepping back from a seek leaves the object space" );
+    auto itr = backend.lower_bound( codec_2.encode( "a" ) );
+    BOOST_REQUIRE( itr != backend.end() );
+    --itr;
+    BOOST_CHECK( itr.key() == codec_1.encode( "e" ) );
+
+    itr = backend.lower_bound( codec_2.upper_bound() );
+    --itr;
+    BOOST_CHECK( itr.key() == codec_2.encode( "e" ) );
+
+    itr = backend.lower_bound( codec_2.encode( "f" ) );
+    --itr;
+    BOOST_CHECK( itr.key() == codec_2.encode( "e" ) );
+
+    itr = backend.lower_bound( empty_codec.encode( "a" ) );
+    BOOST_CHECK( itr == backend.end() );
+    --itr;
+    BOOST_CHECK( itr.key() == codec_3.encode( "e" ) );
+
+    BOOST_TEST_MESSAGE( "Checking find within an object space" );
+    BOOST_REQUIRE( backend.find( codec_3.encode( "c" ) ) != backend.end() );
+    BOOST_CHECK_EQUAL( *backend.find( codec_3.encode( "c" ) ), "c" );
+    BOOST_CHECK( backend.find( codec_3.encode( "b" ) ) == backend.end() );
+    BOOST_CHECK( backend.find( empty_codec.encode( "c" ) ) == backend.end() );
+
+    BOOST_TEST_MESSAGE( "Checking keys without an object space seek in total order" );
+    backend.put( "zed", "z" );
+    itr = backend.lower_bound( "z" );
+    BOOST_REQUIRE( itr != backend.end() );
+    BOOST_CHECK_EQUAL( itr.key(), "zed" );
+    --itr;
+    BOOST_CHECK( itr.key() == codec_3.encode( "e" ) );
+    backend.close();
+
+    BOOST_TEST_MESSAGE( "Checking seeks cross object spaces without the prefix extractor" );
+    options.object_space_prefix = false;
+    backend.open( temp, options );
+    itr = backend.lower_bound( codec_1.encode( "f" ) );
+    BOOST_REQUIRE( itr != backend.end() );
+    BOOST_CHECK( itr.key() == codec_2.encode( "a" ) );
+    backend.close();
+
+    BOOST_TEST_MESSAGE( "Checking an existing database opened with the prefix extractor" );
+    options.object_space_prefix = true;
+    backend.open( temp, options );
+    backend.put( codec_1.encode( "g" ), "g" );
+    itr = backend.lower_bound( codec_1.encode( "d" ) );
+    BOOST_REQUIRE( itr != backend.end() );
+    BOOST_CHECK( itr.key() == codec_1.encode( "e" ) );
+    ++itr;
+    BOOST_REQUIRE( itr != backend.end() );
+    BOOST_CHECK( itr.key() == codec_1.encode( "g" ) );
+    BOOST_REQUIRE( backend.find( codec_2.encode( "c" ) ) != backend.end() );
+    BOOST_CHECK_EQUAL( *backend.find( codec_2.encode( "c" ) ), "c" );
+    backend.close();
+
+    std::filesystem::remove_all( temp );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( incremental_merkle_root_test )
+{
+  try
+  {
+    object_space space;
+    detail::key_codec codec( space );
+    std::string a_key = "a";
+    std::string a_val = "alice";
+    std::string b_key = "b";
+    std::string b_val = "bob";
+    std::string c_key = "c";
+    std::string c_val = "charlie";
+
+    auto shared_db_lock = db.get_shared_lock();
+    auto state_1_id     = crypto::hash( crypto::multicodec::sha2_256, 1 );
+    auto state_1        = db.create_writable_node( db.get_head( shared_db_lock )->id(),
+                                            state_1_id,
+                                            protocol::block_header(),
+                                            shared_db_lock );
+    state_1->put_object( space, b_key, &b_val );
+    state_1->put_object( space, c_key, &c_val );
+    db.finalize_node( state_1_id, shared_db_lock );
+
+    BOOST_TEST_MESSAGE( "Overwriting, removing and writing again in one node" );
+    auto state_2_id = crypto::hash( crypto::multicodec::sha2_256, 2 );
+    auto state_2    = db.create_writable_node( state_1_id, state_2_id, protocol::block_header(), shared_db_lock );
+
+    std::string old_val = "old";
+    state_2->put_object( space, a_key, &old_val );
+    state_2->put_object( space, a_key, &a_val );
+    state_2->remove_object( space, b_key );
+    b_val = "bobby";
+    state_2->put_object( space, b_key, &b_val );
+    state_2->remove_object( space, c_key );
+
+    BOOST_TEST_MESSAGE( "Squashing an anonymous node into the node" );
+    {
+      auto anon_state = state_2->create_anonymous_node();
+      std::string new_c_val = "carol";
+      anon_state->put_object( space, c_key, &new_c_val );
+      c_val = new_c_val;
+      anon_state->commit();
+    }
+
+    db.finalize_node( state_2_id, shared_db_lock );
+
+    // A key removed and written again is hashed as both a removed and a written key, unless the
+    // write was squashed from an anonymous node
+    std::vector< std::string > merkle_leafs;
+    merkle_leafs.push_back( codec.encode( a_key ) );
+    merkle_leafs.push_back( a_val );
+    merkle_leafs.push_back( codec.encode( b_key ) );
+    merkle_leafs.push_back( b_val );
+    merkle_leafs.push_back( codec.encode( b_key ) );
+    merkle_leafs.push_back( b_val );
+    merkle_leafs.push_back( codec.encode( c_key ) );
+    merkle_leafs.push_back( c_val );
+
+    auto merkle_root =
+      koinos::crypto::merkle_tree< std::string >( koinos::crypto::multicodec::sha2_256, merkle_leafs ).root()->hash();
+    BOOST_CHECK_EQUAL( merkle_root, state_2->merkle_root() );
+
+    BOOST_TEST_MESSAGE( "Checking the merkle root survives committing the node" );
+    state_1.reset();
+    state_2.reset();
+    shared_db_lock.reset();
+    db.commit_node( state_2_id, db.get_unique_lock() );
+    BOOST_CHECK_EQUAL( merkle_root, db.get_root( db.get_shared_lock() )->merkle_root() );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( parallel_merkle_root_test )
+{
+  try
+  {
+    object_space space;
+    detail::key_codec codec( space );
+
+    auto shared_db_lock = db.get_shared_lock();
+    auto state_id       = crypto::hash( crypto::multicodec::sha2_256, 1 );
+    auto state          = db.create_writable_node( db.get_head( shared_db_lock )->id(),
+                                          state_id,
+                                          protocol::block_header(),
+                                          shared_db_lock );
+
+    BOOST_TEST_MESSAGE( "Writing enough objects to reduce the merkle tree in parallel" );
+    std::map< std::string, std::string > objects;
+
+    for( int i = 0; i < 10'000; ++i )
+    {
+      auto key   = std::to_string( i );
+      auto value = "value " + std::to_string( i * 7 );
+      state->put_object( space, key, &value );
+      objects[ codec.encode( key ) ] = value;
+    }
+
+    for( int i = 0; i < 10'000; i += 3 )
+    {
+      auto key = std::to_string( i );
+      state->remove_object( space, key );
+      objects[ codec.encode( key ) ] = "";
+    }
+
+    db.finalize_node( state_id, shared_db_lock );
+
+    std::vector< std::string > merkle_leafs;
+    for( const auto& [ key, value ]: objects )
+    {
+      merkle_leafs.push_back( key );
+      merkle_leafs.push_back( value );
+    }
+
+    auto merkle_root =
+      koinos::crypto::merkle_tree< std::string >( koinos::crypto::multicodec::sha2_256, merkle_leafs ).root()->hash();
+    BOOST_CHECK_EQUAL( merkle_root, state->merkle_root() );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( node_index_test )
+{
+  try
+  {
+    BOOST_TEST_MESSAGE( "Creating many forks off the root" );
+    auto shared_db_lock = db.get_shared_lock();
+    auto root_id        = db.get_root( shared_db_lock )->id();
+
+    std::vector< state_node_id > fork_ids;
+    std::vector< state_node_id > child_ids;
+
+    for( uint64_t i = 1; i <= 1'000; ++i )
+    {
+      auto fork_id = crypto::hash( crypto::multicodec::sha2_256, i );
+      BOOST_REQUIRE( db.create_writable_node( root_id, fork_id, protocol::block_header(), shared_db_lock ) );
+      db.finalize_node( fork_id, shared_db_lock );
+      fork_ids.push_back( fork_id );
+
+      auto child_id = crypto::hash( crypto::multicodec::sha2_256, i, i );
+      BOOST_REQUIRE( db.create_writable_node( fork_id, child_id, protocol::block_header(), shared_db_lock ) );
+      child_ids.push_back( child_id );
+    }
+
+    BOOST_CHECK_EQUAL( db.get_all_nodes( shared_db_lock ).size(), 2'001 );
+
+    for( std::size_t i = 0; i < fork_ids.size(); ++i )
+    {
+      auto child = db.get_node( child_ids[ i ], shared_db_lock );
+      BOOST_REQUIRE( child );
+      BOOST_CHECK( child->parent_id() == fork_ids[ i ] );
+    }
+
+    BOOST_TEST_MESSAGE( "Discarding forks discards their children" );
+    for( std::size_t i = 1; i < fork_ids.size(); i += 2 )
+      db.discard_node( fork_ids[ i ], shared_db_lock );
+
+    for( std::size_t i = 0; i < fork_ids.size(); ++i )
+    {
+      BOOST_CHECK_EQUAL( bool( db.get_node( fork_ids[ i ], shared_db_lock ) ), i % 2 == 0 );
+      BOOST_CHECK_EQUAL( bool( db.get_node( child_ids[ i ], shared_db_lock ) ), i % 2 == 0 );
+    }
+
+    auto nodes = db.get_all_nodes( shared_db_lock );
+    BOOST_CHECK_EQUAL( nodes.size(), 1'001 );
+    BOOST_CHECK( std::is_sorted( nodes.begin(),
+                                 nodes.end(),
+                                 []( const state_node_ptr& a, const state_node_ptr& b )
+                                 {
+                                   return a->id() < b->id();
+                                 } ) );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( fork_choice_test )
+{
+  try
+  {
+    BOOST_TEST_MESSAGE( "Resolving a fork storm with the built in and a user supplied pob comparator" );
+
+    auto fork_storm = [ & ]( state_node_comparator_function comp )
+    {
+      db.close( db.get_unique_lock() );
+      std::filesystem::remove_all( temp );
+      std::filesystem::create_directory( temp );
+      db.open( temp, [ & ]( state_node_ptr ) {}, comp, db.get_unique_lock() );
+
+      auto shared_db_lock = db.get_shared_lock();
+      std::vector< state_node_id > nodes{ db.get_root( shared_db_lock )->id() };
+      std::vector< state_node_id > heads;
+      std::mt19937 rng( 0 );
+
+      for( uint64_t i = 1; i <= 500; ++i )
+      {
+        // Build on one of the most recent nodes, so forks compete at the same revision
+        auto parent_id = nodes[ nodes.size() - 1 - rng() % std::min< std::size_t >( nodes.size(), 8 ) ];
+
+        protocol::block_header header;
+        header.set_timestamp( 100 + rng() % 16 );
+        header.set_signer( "signer" + std::to_string( rng() % 2 ) );
+
+        auto node_id = crypto::hash( crypto::multicodec::sha2_256, i );
+        BOOST_REQUIRE( db.create_writable_node( parent_id, node_id, header, shared_db_lock ) );
+        db.finalize_node( node_id, shared_db_lock );
+        nodes.push_back( node_id );
+        heads.push_back( db.get_head( shared_db_lock )->id() );
+      }
+
+      for( const auto& fork_head: db.get_fork_heads( shared_db_lock ) )
+        heads.push_back( fork_head->id() );
+
+      return heads;
+    };
+
+    auto builtin_heads = fork_storm( &state_db::pob_comparator );
+    auto user_heads    = fork_storm(
+      []( fork_list& forks, state_node_ptr head, state_node_ptr new_head )
+      {
+        return state_db::pob_comparator( forks, head, new_head );
+      } );
+
+    BOOST_REQUIRE_EQUAL( builtin_heads.size(), user_heads.size() );
+    BOOST_CHECK( builtin_heads == user_heads );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( ancestor_test )
+{
+  try
+  {
+    BOOST_TEST_MESSAGE( "Building a tree of forks off a long chain" );
+    auto shared_db_lock = db.get_shared_lock();
+    auto root_id        = db.get_root( shared_db_lock )->id();
+
+    std::vector< state_node_id > chain{ root_id };
+    std::vector< state_node_id > forks;
+    uint64_t next_id = 1;
+
+    for( uint64_t i = 1; i <= 300; ++i )
+    {
+      auto node_id = crypto::hash( crypto::multicodec::sha2_256, next_id++ );
+      BOOST_REQUIRE( db.create_writable_node( chain.back(), node_id, protocol::block_header(), shared_db_lock ) );
+      db.finalize_node( node_id, shared_db_lock );
+      chain.push_back( node_id );
+    }
+
+    for( std::size_t base = 10; base < chain.size(); base += 37 )
+    {
+      auto parent_id = chain[ base ];
+      for( uint64_t i = 0; i < base % 23 + 1; ++i )
+      {
+        auto node_id = crypto::hash( crypto::multicodec::sha2_256, next_id++ );
+        BOOST_REQUIRE( db.create_writable_node( parent_id, node_id, protocol::block_header(), shared_db_lock ) );
+        db.finalize_node( node_id, shared_db_lock );
+        parent_id = node_id;
+      }
+      forks.push_back( parent_id );
+    }
+
+    auto naive_ancestor = [ & ]( state_node_id id, uint64_t revision )
+    {
+      auto node = db.get_node( id, shared_db_lock );
+      while( node->revision() > revision )
+        node = std::dynamic_pointer_cast< state_node >( node->parent() );
+      return node->id();
+    };
+
+    auto naive_common_ancestor = [ & ]( state_node_id a, state_node_id b )
+    {
+      auto revision = std::min( db.get_node( a, shared_db_lock )->revision(),
+                                db.get_node( b, shared_db_lock )->revision() );
+      a             = naive_ancestor( a, revision );
+      b             = naive_ancestor( b, revision );
+      while( a != b )
+      {
+        a = db.get_node( a, shared_db_lock )->parent_id();
+        b = db.get_node( b, shared_db_lock )->parent_id();
+      }
+      return a;
+    };
+
+    auto check_tree = [ & ]( uint64_t root_revision )
+    {
+      for( const auto& fork: forks )
+      {
+        auto fork_node = db.get_node( fork, shared_db_lock );
+        if( !fork_node )
+          continue;
+
+        for( uint64_t revision = root_revision; revision <= fork_node->revision(); ++revision )
+          BOOST_CHECK( db.get_node_at_revision( revision, fork, shared_db_lock )->id()
+                       == naive_ancestor( fork, revision ) );
+
+        BOOST_CHECK( db.get_common_ancestor( fork, chain.back(), shared_db_lock )->id()
+                     == naive_common_ancestor( fork, chain.back() ) );
+
+        for( const auto& other: forks )
+        {
+          if( db.get_node( other, shared_db_lock ) )
+            BOOST_CHECK( db.get_common_ancestor( fork, other, shared_db_lock )->id()
+                         == naive_common_ancestor( fork, other ) );
+        }
+      }
+
+      for( std::size_t i = root_revision; i < chain.size(); i += 7 )
+        BOOST_CHECK( db.get_common_ancestor( chain[ i ], chain.back(), shared_db_lock )->id() == chain[ i ] );
+    };
+
+    check_tree( 0 );
+
+    BOOST_TEST_MESSAGE( "Checking a missing node has no common ancestor" );
+    BOOST_CHECK( !db.get_common_ancestor( crypto::hash( crypto::multicodec::sha2_256, next_id ),
+                                          chain.back(),
+                                          shared_db_lock ) );
+
+    BOOST_TEST_MESSAGE( "Checking ancestors after committing part of the chain" );
+    shared_db_lock.reset();
+    db.commit_node( chain[ 120 ], db.get_unique_lock() );
+    shared_db_lock = db.get_shared_lock();
+
+    check_tree( 120 );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( index_snapshot_test )
+{
+  try
+  {
+    BOOST_TEST_MESSAGE( "Reading nodes while they are created, finalized and discarded" );
+    auto shared_db_lock = db.get_shared_lock();
+    auto root_id        = db.get_root( shared_db_lock )->id();
+
+    // Boost.Test assertions are not thread safe, readers count what they saw instead
+    std::atomic< bool > done          = false;
+    std::atomic< uint64_t > reads     = 0;
+    std::atomic< uint64_t > bad_reads = 0;
+    std::vector< std::thread > readers;
+
+    for( int i = 0; i < 4; ++i )
+    {
+      readers.emplace_back(
+        [ & ]()
+        {
+          uint64_t last_revision = 0;
+          while( !done )
+          {
+            auto head = db.get_head( shared_db_lock );
+            auto node = db.get_node( head->id(), shared_db_lock );
+
+            if( head->revision() < last_revision || !node || node->id() != head->id()
+                || db.get_node_at_revision( 0, head->id(), shared_db_lock )->id() != root_id
+                || db.get_fork_heads( shared_db_lock ).empty() )
+              ++bad_reads;
+
+            last_revision = head->revision();
+            ++reads;
+          }
+        } );
+    }
+
+    // Publishing is cheap, so the writer waits for the readers to be reading before it starts
+    while( reads == 0 )
+      std::this_thread::yield();
+
+    auto parent_id = root_id;
+    for( uint64_t i = 1; i <= 300; ++i )
+    {
+      auto node_id = crypto::hash( crypto::multicodec::sha2_256, i );
+      BOOST_REQUIRE( db.create_writable_node( parent_id, node_id, protocol::block_header(), shared_db_lock ) );
+
+      auto fork_id = crypto::hash( crypto::multicodec::sha2_256, i, i );
+      BOOST_REQUIRE( db.create_writable_node( parent_id, fork_id, protocol::block_header(), shared_db_lock ) );
+
+      db.finalize_node( node_id, shared_db_lock );
+      db.discard_node( fork_id, shared_db_lock );
+      parent_id = node_id;
+    }
+
+    done = true;
+    for( auto& reader: readers )
+      reader.join();
+
+    BOOST_CHECK( reads > 0 );
+    BOOST_CHECK_EQUAL( bad_reads, 0 );
+    BOOST_CHECK( db.get_head( shared_db_lock )->id() == parent_id );
+    BOOST_CHECK_EQUAL( db.get_all_nodes( shared_db_lock ).size(), 301 );
+
+    BOOST_TEST_MESSAGE( "Checking the published nodes after many publishes" );
+    for( uint64_t i = 1; i <= 300; ++i )
+    {
+      BOOST_CHECK( db.get_node( crypto::hash( crypto::multicodec::sha2_256, i ), shared_db_lock ) );
+      BOOST_CHECK( !db.get_node( crypto::hash( crypto::multicodec::sha2_256, i, i ), shared_db_lock ) );
+    }
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
+BOOST_AUTO_TEST_CASE( lock_token_test )
+{
+  try
+  {
+    BOOST_TEST_MESSAGE( "Copies of a lock share its hold" );
+    auto shared_db_lock = db.get_shared_lock();
+    auto lock_copy      = shared_db_lock;
+    BOOST_CHECK( lock_copy == shared_db_lock );
+    BOOST_CHECK( db.get_shared_lock() != shared_db_lock );
+
+    shared_db_lock.reset();
+    BOOST_CHECK( !shared_db_lock );
+    BOOST_CHECK( lock_copy );
+    BOOST_CHECK( db.get_head( lock_copy ) );
+
+    BOOST_TEST_MESSAGE( "Taking more shared locks than there are slots" );
+    std::vector< shared_lock_ptr > locks;
+    for( int i = 0; i < 1'000; ++i )
+      locks.push_back( db.get_shared_lock() );
+
+    for( const auto& lock: locks )
+      BOOST_CHECK( db.get_root( lock ) );
+
+    locks.clear();
+
+    BOOST_TEST_MESSAGE( "A node keeps the database locked until it is released" );
+    auto head = db.get_head( lock_copy );
+    lock_copy.reset();
+
+    std::atomic< bool > locked = false;
+    std::thread writer(
+      [ & ]()
+      {
+        auto unique_db_lock = db.get_unique_lock();
+        locked              = true;
+      } );
+
+    std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+    BOOST_CHECK( !locked );
+
+    head.reset();
+    writer.join();
+    BOOST_CHECK( locked );
+
+    BOOST_CHECK( db.get_head( db.get_unique_lock() ) );
+  }
+  KOINOS_CATCH_LOG_AND_RETHROW( info )
+}
+
 BOOST_AUTO_TEST_SUITE_END()